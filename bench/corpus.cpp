@@ -0,0 +1,150 @@
+#include "corpus.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+// Appends randomly chosen but realistic log fields
+struct LogLineGenerator {
+    std::mt19937 rng;
+
+    explicit LogLineGenerator(uint32_t seed) : rng(seed) {}
+
+    size_t pick(size_t count) { return rng() % count; }
+
+    void append_line(std::string& out) {
+        static const char* levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+        static const char* methods[] = {"GET", "GET", "GET", "POST", "PUT", "DELETE"};
+        static const char* resources[] = {"items", "users", "orders", "sessions", "carts"};
+        static const char* words[] = {"served", "request", "from", "cache", "miss", "upstream",
+                                      "timeout", "retry", "the", "client", "closed", "connection"};
+
+        char stamp[32];
+        std::snprintf(stamp, sizeof(stamp), "2024-%02zu-%02zuT%02zu:%02zu:%02zuZ ", 1 + pick(12), 1 + pick(28),
+                      pick(24), pick(60), pick(60));
+        out += stamp;
+        out += levels[pick(6)];
+        out += " host-";
+        out += std::to_string(pick(64));
+        out += ' ';
+        out += methods[pick(6)];
+        out += " /api/v1/";
+        out += resources[pick(5)];
+        out += '/';
+        out += std::to_string(pick(100000));
+
+        size_t word_count = 2 + pick(8);
+        for (size_t i = 0; i < word_count; i++) {
+            const char* word = words[pick(12)];
+            out += ' ';
+            out += word;
+            if (pick(40) == 0) {
+                out += ' ';
+                out += word; // doubled word for backreference patterns
+            }
+        }
+        out += ' ';
+        out += std::to_string(pick(2000));
+        out += "ms\n";
+    }
+};
+
+std::string generate_log(size_t bytes, uint32_t seed) {
+    LogLineGenerator generator(seed);
+    std::string out;
+    out.reserve(bytes + 256);
+    while (out.size() < bytes) {
+        generator.append_line(out);
+    }
+    return out;
+}
+
+std::string generate_long_lines(size_t bytes, uint32_t seed) {
+    constexpr size_t kLineLength = 64 << 10;
+    std::string out = generate_log(bytes, seed);
+    size_t last_break = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (out[i] != '\n') continue;
+        if (i - last_break < kLineLength) {
+            out[i] = ' ';
+        } else {
+            last_break = i;
+        }
+    }
+    if (!out.empty()) out.back() = '\n';
+    return out;
+}
+
+std::string generate_dense(size_t bytes, uint32_t seed) {
+    std::mt19937 rng(seed);
+    static const char* lines[] = {
+        "ERROR host-1 GET timeout timeout 12ms\n",
+        "ERROR host-22 POST served served 3ms\n",
+        "WARN host-3 DELETE retry retry 450ms\n",
+        "INFO host-4 host-5 GET the the 7ms\n",
+    };
+    std::string out;
+    out.reserve(bytes + 64);
+    while (out.size() < bytes) {
+        out += lines[rng() % 4];
+    }
+    return out;
+}
+
+std::string generate_pathological(size_t bytes) {
+    std::string out;
+    out.reserve(bytes + 256);
+    for (size_t line = 0; out.size() < bytes; line++) {
+        if (line % 2 == 0) {
+            // The literals up front get the line past the prefilter, the run of
+            // 'a' then almost matches (a|aa)+\1xy and (a*)*c$ style patterns
+            out += "xyc ";
+            out.append(200, 'a');
+            out += "x\n";
+        } else {
+            for (int i = 0; i < 30; i++) out += "word ";
+            out += "end\n";
+        }
+    }
+    return out;
+}
+
+size_t generate_tree(const std::filesystem::path& root, size_t bytes, int depth, uint32_t seed) {
+    constexpr size_t kFileSize = 16 << 10;
+    constexpr int kFanout = 3;
+
+    LogLineGenerator generator(seed);
+    size_t file_count = 0;
+    size_t written = 0;
+    std::string contents;
+
+    // Number directories like an odometer so files spread over every level
+    for (size_t index = 0; written < bytes; index++) {
+        std::filesystem::path directory = root;
+        size_t rest = index;
+        int levels = static_cast<int>(index % (depth + 1));
+        for (int level = 0; level < levels; level++) {
+            directory /= "d" + std::to_string(rest % kFanout);
+            rest /= kFanout;
+        }
+
+        contents.clear();
+        while (contents.size() < kFileSize) {
+            generator.append_line(contents);
+        }
+        write_corpus_file(directory / ("f" + std::to_string(index) + ".log"), contents);
+        written += contents.size();
+        file_count++;
+    }
+    return file_count;
+}
+
+void write_corpus_file(const std::filesystem::path& path, std::string_view contents) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    if (!out) {
+        throw std::runtime_error("Could not write corpus file '" + path.string() + "'");
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Synthetic inputs for grep_bench. Output depends only on the arguments, so
+// runs on different machines and revisions scan identical bytes.
+
+// Application-log lines: timestamp, level, host, request, path, latency
+std::string generate_log(size_t bytes, uint32_t seed);
+
+// Log text joined into lines of about 64 KiB
+std::string generate_long_lines(size_t bytes, uint32_t seed);
+
+// Short lines where nearly every line matches the benchmark patterns
+std::string generate_dense(size_t bytes, uint32_t seed);
+
+// Long runs of 'a' and repeated words that make backtracking patterns explode
+std::string generate_pathological(size_t bytes);
+
+// Directory tree `depth` levels deep filled with small log files totalling
+// about `bytes`; returns the number of files written
+size_t generate_tree(const std::filesystem::path& root, size_t bytes, int depth, uint32_t seed);
+
+// Write contents to path, creating parent directories; throws std::runtime_error on failure
+void write_corpus_file(const std::filesystem::path& path, std::string_view contents);
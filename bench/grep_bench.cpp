@@ -0,0 +1,381 @@
+// grep_bench: generates reproducible corpora and times the matcher (per line,
+// batched and compile-time) and the file and recursive pipelines over a fixed pattern matrix.
+// Results are printed to stdout as JSON; progress goes to stderr. That StaticPattern agrees
+// with the runtime engine is checked by tests/static_pattern_agreement.cpp.
+//
+//   grep_bench [--size-mb N] [--iterations N] [-j N] [--filter TEXT] [--dir PATH] [--keep]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "corpus.hpp"
+#include "file_scanner.hpp"
+#include "input.hpp"
+#include "matcher.hpp"
+#include "output_writer.hpp"
+#include "pattern.hpp"
+#include "recursive_search.hpp"
+#include "static_pattern.hpp"
+#include "work_stealing_pool.hpp"
+
+struct BenchOptions {
+    size_t size_mb = 32;     // --size-mb, size of each text corpus
+    int iterations = 3;      // --iterations, best run is reported
+    int jobs = 0;            // -j, pipeline workers; 0 picks the number of cores
+    std::string filter;      // --filter, only cases whose name contains this
+    std::filesystem::path directory;  // --dir, where corpora are written
+    bool keep = false;       // --keep, leave corpora on disk
+};
+
+// One input a pattern is run over
+struct Corpus {
+    std::string name;
+    std::filesystem::path path;
+    std::string contents;  // empty for the directory tree
+    size_t bytes = 0;
+    size_t lines = 0;
+};
+
+// One entry of the pattern matrix
+struct PatternCase {
+    const char* name;
+    const char* pattern;
+    bool pathological;  // run only on the pathological corpus
+};
+
+const PatternCase kPatternMatrix[] = {
+    {"literal", "timeout", false},
+    {"literal_absent", "segfault", false},
+    {"class", "[0-9]+ms", false},
+    {"alternation", "GET|PUT|DELETE", false},
+    {"nested_groups", "(host-(\\d+) )+(GET|POST) /api/v1/(items|users)", false},
+    {"backreference", "(\\w+) \\1", false},
+    {"anchors", "^2024-0[1-6].*ERROR.*ms$", false},
+    {"nested_star", "(a*)*c$", true},
+    {"backreference_blowup", "(a|aa)+(a|aa)+\\1xy", true},
+};
+
+// Patterns of the matrix that are also run through StaticPattern
+template <PatternString... Patterns>
+struct StaticCases {};
+
+using kStaticCases = StaticCases<"timeout", "segfault", "[0-9]+ms", "GET|PUT|DELETE",
+                                 "(host-(\\d+) )+(GET|POST) /api/v1/(items|users)", "^2024-0[1-6].*ERROR.*ms$",
+                                 "(a*)*c$">;
+
+constexpr size_t kUnknownCount = static_cast<size_t>(-1);
+
+// Result of one timed benchmark, written as a JSON object
+struct Result {
+    std::string benchmark;
+    std::string corpus;
+    const PatternCase* pattern;
+    size_t bytes;
+    size_t lines;
+    size_t matches;  // kUnknownCount when the pipeline does not report it
+    size_t skipped_lines;
+    double seconds;
+};
+
+std::string json_escape(std::string_view text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Peak resident set size of the whole run, in KiB. The kernel only tracks a
+// process-wide high-water mark, so it cannot be split between cases.
+long peak_rss_kb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+size_t count_lines(std::string_view text) {
+    size_t lines = 0;
+    for (char c : text) {
+        if (c == '\n') lines++;
+    }
+    return lines;
+}
+
+// Run body `iterations` times and return the fastest wall-clock time in seconds
+template <typename Body>
+double best_time(int iterations, Body&& body) {
+    double best = 0;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (i == 0 || elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+// match_string on every line of an in-memory corpus
+Result bench_match_string(const Corpus& corpus, const PatternCase& pattern_case, int iterations) {
+    CompiledPattern compiled = compile_pattern(pattern_case.pattern);
+
+    std::vector<std::string_view> lines;
+    std::string_view text = corpus.contents;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) end = text.size();
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+
+    size_t matches = 0;
+    take_skipped_lines();
+    double seconds = best_time(iterations, [&] {
+        matches = 0;
+        for (std::string_view line : lines) {
+            if (match_string(line, compiled)) matches++;
+        }
+    });
+    size_t skipped = take_skipped_lines() / iterations;
+    return {"match_string", corpus.name, &pattern_case, corpus.bytes, corpus.lines, matches, skipped, seconds};
+}
+
+// StaticPattern<Pattern>::matches on every line
+template <PatternString Pattern>
+Result bench_static_pattern(const Corpus& corpus, const PatternCase& pattern_case, int iterations) {
+    std::vector<std::string_view> lines;
+    std::string_view text = corpus.contents;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) end = text.size();
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+
+    size_t matches = 0;
+    double seconds = best_time(iterations, [&] {
+        matches = 0;
+        for (std::string_view line : lines) {
+            if (StaticPattern<Pattern>::matches(line)) matches++;
+        }
+    });
+    return {"static_pattern", corpus.name, &pattern_case, corpus.bytes, corpus.lines, matches, 0, seconds};
+}
+
+// Run bench_static_pattern if one of the static cases is this pattern case
+template <PatternString... Patterns>
+void bench_static_cases(StaticCases<Patterns...>, const Corpus& corpus, const PatternCase& pattern_case,
+                        int iterations, std::vector<Result>& results) {
+    auto run = [&]<PatternString Pattern>() {
+        if (StaticPattern<Pattern>::source() == pattern_case.pattern) {
+            results.push_back(bench_static_pattern<Pattern>(corpus, pattern_case, iterations));
+        }
+    };
+    (run.template operator()<Patterns>(), ...);
+}
+
+// match_buffer_lines over the whole corpus with precomputed line offsets
+Result bench_match_batch(const Corpus& corpus, const PatternCase& pattern_case, int iterations) {
+    CompiledPattern compiled = compile_pattern(pattern_case.pattern);
+
+    std::vector<size_t> offsets{0};
+    std::string_view text = corpus.contents;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        end = (end == std::string_view::npos) ? text.size() : end + 1;
+        offsets.push_back(end);
+        start = end;
+    }
+
+    MatchScratch scratch;
+    MatchBitmap bitmap;
+    size_t matches = 0;
+    double seconds = best_time(iterations, [&] {
+        matches = match_buffer_lines(text, offsets, compiled, scratch, bitmap);
+    });
+    size_t skipped = scratch.take_skipped_lines() / iterations;
+    return {"match_batch", corpus.name, &pattern_case, corpus.bytes, corpus.lines, matches, skipped, seconds};
+}
+
+// Whole file branch: mapping, chunked scanning and ordered output to /dev/null
+Result bench_file_pipeline(const Corpus& corpus, const PatternCase& pattern_case, int iterations, int jobs,
+                           int null_fd) {
+    CompiledPattern compiled = compile_pattern(pattern_case.pattern);
+    size_t matches = 0;
+    double seconds = best_time(iterations, [&] {
+        OutputWriter writer(null_fd);
+        FileScanner scanner(compiled, jobs, 1024, writer, [](const std::string& path) {
+            std::cerr << "Error: Could not open file '" << path << "'" << std::endl;
+        });
+        scanner.add_file(corpus.path.string(), "");
+        scanner.wait();
+        writer.flush();
+        matches = scanner.matched_lines();
+    });
+    return {"file_pipeline", corpus.name, &pattern_case, corpus.bytes, corpus.lines, matches, 0, seconds};
+}
+
+// -r over the directory tree, output to /dev/null
+Result bench_recursive_pipeline(const Corpus& tree, const PatternCase& pattern_case, int iterations, int jobs,
+                                int null_fd) {
+    CompiledPattern compiled = compile_pattern(pattern_case.pattern);
+    double seconds = best_time(iterations, [&] {
+        OutputWriter writer(null_fd);
+        search_recursive({tree.path.string()}, compiled, jobs, 1024, writer);
+        writer.flush();
+    });
+    return {"recursive_pipeline", tree.name, &pattern_case, tree.bytes, tree.lines, kUnknownCount, 0, seconds};
+}
+
+void print_result(const Result& result, bool last) {
+    double megabytes = static_cast<double>(result.bytes) / (1 << 20);
+    std::string matches = (result.matches == kUnknownCount) ? "null" : std::to_string(result.matches);
+    std::printf("    {\"benchmark\": \"%s\", \"corpus\": \"%s\", \"case\": \"%s\", \"pattern\": \"%s\", "
+                "\"bytes\": %zu, \"lines\": %zu, \"matches\": %s, \"skipped_lines\": %zu, \"seconds\": %.6f, "
+                "\"mb_per_s\": %.2f, \"lines_per_s\": %.0f}%s\n",
+                result.benchmark.c_str(), result.corpus.c_str(), result.pattern->name,
+                json_escape(result.pattern->pattern).c_str(), result.bytes, result.lines, matches.c_str(),
+                result.skipped_lines, result.seconds, megabytes / result.seconds, result.lines / result.seconds,
+                last ? "" : ",");
+}
+
+bool parse_bench_options(int argc, char* argv[], BenchOptions& options, std::string& error) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool takes_value = arg == "--size-mb" || arg == "--iterations" || arg == "-j" || arg == "--filter" ||
+                           arg == "--dir";
+        if (takes_value && !value) {
+            error = "Option " + arg + " requires a value";
+            return false;
+        }
+
+        if (arg == "--size-mb") options.size_mb = std::strtoul(value, nullptr, 10);
+        else if (arg == "--iterations") options.iterations = std::atoi(value);
+        else if (arg == "-j") options.jobs = std::atoi(value);
+        else if (arg == "--filter") options.filter = value;
+        else if (arg == "--dir") options.directory = value;
+        else if (arg == "--keep") options.keep = true;
+        else {
+            error = "Unknown option '" + arg + "'";
+            return false;
+        }
+        if (takes_value) i++;
+    }
+    if (options.size_mb == 0 || options.iterations < 1 || options.jobs < 0) {
+        error = "Sizes and counts must be positive";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    std::string usage_error;
+    if (!parse_bench_options(argc, argv, options, usage_error)) {
+        std::cerr << usage_error << std::endl;
+        std::cerr << "Usage: " << argv[0]
+                  << " [--size-mb N] [--iterations N] [-j N] [--filter TEXT] [--dir PATH] [--keep]" << std::endl;
+        return 1;
+    }
+    int jobs = (options.jobs > 0) ? options.jobs : default_job_count();
+    bool own_directory = options.directory.empty();
+    if (own_directory) {
+        options.directory = std::filesystem::temp_directory_path() / ("grep_bench-" + std::to_string(getpid()));
+    }
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) {
+        std::cerr << "Error: Could not open /dev/null" << std::endl;
+        return 1;
+    }
+
+    try {
+        const size_t size = options.size_mb << 20;
+        std::vector<Corpus> corpora;
+        auto add_corpus = [&](const std::string& name, std::string contents) {
+            std::cerr << "Generating " << name << " corpus" << std::endl;
+            Corpus corpus;
+            corpus.name = name;
+            corpus.path = options.directory / (name + ".txt");
+            corpus.bytes = contents.size();
+            corpus.lines = count_lines(contents);
+            corpus.contents = std::move(contents);
+            write_corpus_file(corpus.path, corpus.contents);
+            corpora.push_back(std::move(corpus));
+        };
+        add_corpus("log", generate_log(size, 1));
+        add_corpus("long_lines", generate_long_lines(size, 2));
+        add_corpus("dense", generate_dense(size / 4, 3));
+        // Every other line runs into the backtracking step limit, so keep this one small
+        add_corpus("pathological", generate_pathological(16 << 10));
+
+        std::cerr << "Generating tree corpus" << std::endl;
+        Corpus tree;
+        tree.name = "tree";
+        tree.path = options.directory / "tree";
+        generate_tree(tree.path, size, 8, 4);
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(tree.path)) {
+            if (!entry.is_regular_file()) continue;
+            InputFile file;
+            if (file.open(entry.path().string())) {
+                tree.bytes += file.contents().size();
+                tree.lines += count_lines(file.contents());
+            }
+        }
+
+        std::vector<Result> results;
+        for (const PatternCase& pattern_case : kPatternMatrix) {
+            if (!options.filter.empty() && std::string(pattern_case.name).find(options.filter) == std::string::npos) {
+                continue;
+            }
+            std::cerr << "Running " << pattern_case.name << std::endl;
+            for (const Corpus& corpus : corpora) {
+                if (pattern_case.pathological != (corpus.name == "pathological")) continue;
+                results.push_back(bench_match_string(corpus, pattern_case, options.iterations));
+                results.push_back(bench_match_batch(corpus, pattern_case, options.iterations));
+                bench_static_cases(kStaticCases{}, corpus, pattern_case, options.iterations, results);
+            }
+            if (pattern_case.pathological) continue;
+            results.push_back(bench_file_pipeline(corpora.front(), pattern_case, options.iterations, jobs, null_fd));
+            results.push_back(bench_recursive_pipeline(tree, pattern_case, options.iterations, jobs, null_fd));
+        }
+
+        std::printf("{\n  \"size_mb\": %zu,\n  \"iterations\": %d,\n  \"jobs\": %d,\n  \"results\": [\n",
+                    options.size_mb, options.iterations, jobs);
+        for (size_t i = 0; i < results.size(); i++) {
+            print_result(results[i], i + 1 == results.size());
+        }
+        std::printf("  ],\n  \"peak_rss_kb\": %ld\n}\n", peak_rss_kb());
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        close(null_fd);
+        return 1;
+    }
+
+    close(null_fd);
+    if (own_directory && !options.keep) {
+        std::error_code error;
+        std::filesystem::remove_all(options.directory, error);
+    }
+    return 0;
+}
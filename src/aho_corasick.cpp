@@ -0,0 +1,93 @@
+#include "aho_corasick.hpp"
+
+#include <stdexcept>
+
+AhoCorasick::AhoCorasick(const std::vector<std::string>& needles) {
+    needle_count_ = needles.size();
+
+    // Bytes that occur in no needle behave alike, so they share class 0
+    std::array<bool, 256> used{};
+    for (const std::string& needle : needles) {
+        for (char c : needle) used[static_cast<unsigned char>(c)] = true;
+        if (needle.empty()) empty_needle_ = true;
+    }
+    for (int c = 0; c < 256; c++) {
+        if (used[c]) byte_classes_[c] = static_cast<uint8_t>(class_count_++);
+    }
+
+    // Trie with dense child rows; -1 marks a missing child
+    std::vector<int32_t> children(class_count_, -1);
+    match_lengths_.assign(1, 0);
+    for (const std::string& needle : needles) {
+        int32_t state = 0;
+        for (char c : needle) {
+            size_t slot = state * class_count_ + byte_classes_[static_cast<unsigned char>(c)];
+            if (children[slot] < 0) {
+                children[slot] = static_cast<int32_t>(match_lengths_.size());
+                match_lengths_.push_back(0);
+                children.resize(children.size() + class_count_, -1);
+            }
+            state = children[slot];
+        }
+        if (!needle.empty()) match_lengths_[state] = static_cast<uint32_t>(needle.size());
+    }
+
+    size_t state_count = match_lengths_.size();
+    if (state_count * class_count_ >= kMatchBit) {
+        throw std::runtime_error("Literal set too large");
+    }
+
+    // Breadth-first over the trie: each missing child borrows the transition of
+    // the failure state, which is always shallower and so already complete
+    std::vector<uint32_t> failure(state_count, 0);
+    std::vector<uint32_t> queue;
+    queue.reserve(state_count);
+    for (uint32_t c = 0; c < class_count_; c++) {
+        if (children[c] > 0) queue.push_back(children[c]);
+        else children[c] = 0;
+    }
+    for (size_t head = 0; head < queue.size(); head++) {
+        uint32_t state = queue[head];
+        if (match_lengths_[state] == 0) {
+            match_lengths_[state] = match_lengths_[failure[state]]; // a needle ending in a suffix
+        }
+        for (uint32_t c = 0; c < class_count_; c++) {
+            int32_t& child = children[state * class_count_ + c];
+            int32_t fallback = children[failure[state] * class_count_ + c];
+            if (child < 0) {
+                child = fallback;
+            } else {
+                failure[child] = fallback;
+                queue.push_back(child);
+            }
+        }
+    }
+
+    transitions_.resize(children.size());
+    for (size_t i = 0; i < children.size(); i++) {
+        uint32_t target = static_cast<uint32_t>(children[i]);
+        transitions_[i] = target * class_count_ | (match_lengths_[target] ? kMatchBit : 0);
+    }
+}
+
+size_t AhoCorasick::find(std::string_view haystack, size_t from) const {
+    if (needle_count_ == 0 || from > haystack.size()) {
+        return std::string_view::npos;
+    }
+    if (empty_needle_) {
+        return from;
+    }
+
+    const uint32_t* table = transitions_.data();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(haystack.data());
+    uint32_t row = 0;
+    for (size_t i = from; i < haystack.size(); i++) {
+        uint32_t next = table[row + byte_classes_[data[i]]];
+        row = next & ~kMatchBit;
+        if (next & kMatchBit) {
+            return i + 1 - match_lengths_[row / class_count_];
+        }
+    }
+    return std::string_view::npos;
+}
+
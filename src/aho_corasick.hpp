@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Multi-literal search over a fixed set of needles. The trie and its failure
+// links are flattened into a full DFA indexed by byte class, so the scan is
+// one table lookup per input byte however many needles the set holds.
+class AhoCorasick {
+public:
+    AhoCorasick() = default;
+    explicit AhoCorasick(const std::vector<std::string>& needles);
+
+    bool empty() const { return needle_count_ == 0; }
+    size_t size() const { return needle_count_; }
+
+    // Start offset of the occurrence that ends first at or after `from`, or
+    // npos. No other occurrence ends before it, so one that lies within a
+    // line is found no later than any occurrence in a following line.
+    size_t find(std::string_view haystack, size_t from = 0) const;
+
+    bool contains(std::string_view haystack) const { return find(haystack) != std::string_view::npos; }
+
+private:
+    // Set on a transition whose target state ends at least one needle
+    static constexpr uint32_t kMatchBit = 1u << 31;
+
+    size_t needle_count_ = 0;
+    std::array<uint8_t, 256> byte_classes_{};
+    uint32_t class_count_ = 1;
+    std::vector<uint32_t> transitions_;    // row offset (state x class_count_) of the target, plus kMatchBit
+    std::vector<uint32_t> match_lengths_;  // per state: length of a needle ending there, 0 for none
+    bool empty_needle_ = false;            // the empty string matches everywhere
+};
@@ -0,0 +1,254 @@
+#include "backtracker.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "stats.hpp"
+
+// Number of bytes from pos, up to max_length, that a single-byte instruction accepts
+int Backtracker::run_length(const Instruction& inst, int pos, int max_length) const {
+    int available = std::min(max_length, static_cast<int>(input_.size()) - pos);
+    switch (inst.op) {
+        case Opcode::Any:
+            return available;
+        case Opcode::Class:
+            // Vectorized scan over the whole run of class members
+            return static_cast<int>(program_->classes[inst.x].span(input_.data() + pos, available));
+        default: {
+            int length = 0;
+            while (length < available && static_cast<unsigned char>(input_[pos + length]) == inst.byte) {
+                length++;
+            }
+            return length;
+        }
+    }
+}
+
+static bool is_single_byte(Opcode op) {
+    return op == Opcode::Byte || op == Opcode::Any || op == Opcode::Class;
+}
+
+// Find the instructions from which no backreference can be reached
+void Backtracker::prepare(const Program& program) {
+    program_id_ = program.id;
+    const std::vector<Instruction>& code = program.code;
+    const int size = static_cast<int>(code.size());
+    std::vector<bool> memoizable(size, true);
+
+    // Propagate backwards along edges until nothing changes; loops need several passes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pc = size - 1; pc >= 0; pc--) {
+            if (!memoizable[pc]) continue;
+            const Instruction& inst = code[pc];
+            bool reaches_backref = false;
+            switch (inst.op) {
+                case Opcode::Backref:     reaches_backref = true; break;
+                case Opcode::Match:       break;
+                case Opcode::Jump:        reaches_backref = !memoizable[inst.x]; break;
+                case Opcode::Split:       reaches_backref = !memoizable[inst.x] || !memoizable[inst.y]; break;
+                case Opcode::RepeatCheck: reaches_backref = !memoizable[inst.y] || !memoizable[pc + 1]; break;
+                default:                  reaches_backref = !memoizable[pc + 1]; break;
+            }
+            if (reaches_backref) {
+                memoizable[pc] = false;
+                changed = true;
+            }
+        }
+    }
+
+    memo_rows_.assign(size, -1);
+    memo_row_count_ = 0;
+    for (int pc = 0; pc < size; pc++) {
+        if (memoizable[pc]) memo_rows_[pc] = memo_row_count_++;
+    }
+}
+
+// Record a state; false if it was already explored and cannot lead to a match
+bool Backtracker::visit(int pc, int pos) {
+    if (visited_.empty() || memo_rows_[pc] < 0) {
+        return true;
+    }
+    size_t bit = static_cast<size_t>(memo_rows_[pc]) * visited_stride_ + pos;
+    uint64_t mask = uint64_t{1} << (bit % 64);
+    if (visited_[bit / 64] & mask) {
+        return false;
+    }
+    visited_[bit / 64] |= mask;
+    return true;
+}
+
+BacktrackResult Backtracker::try_at(int start) {
+    const std::vector<Instruction>& code = program_->code;
+    const int length = static_cast<int>(input_.size());
+
+    std::fill(slots_.begin(), slots_.end(), -1);
+    stack_.clear();
+    stack_.push_back({JobKind::Run, 0, start, 0});
+
+    while (!stack_.empty()) {
+        Job job = stack_.back();
+        stack_.pop_back();
+
+        switch (job.kind) {
+            case JobKind::RestoreSlot:
+                slots_[job.pc] = job.pos;
+                continue;
+            case JobKind::RestoreLoop:
+                loop_positions_[job.pc] = job.pos;
+                continue;
+            case JobKind::Shorten:
+                // Give back one more byte of the run before retrying the continuation
+                if (job.pos > job.limit) {
+                    stack_.push_back({JobKind::Shorten, job.pc, job.pos - 1, job.limit});
+                }
+                break;
+            case JobKind::Run:
+                break;
+        }
+
+        int pc = job.pc;
+        int pos = job.pos;
+        bool failed = false;
+
+        while (!failed) {
+            if (steps_left_ == 0) {
+                return BacktrackResult::StepLimit;
+            }
+            steps_left_--;
+            const Instruction& inst = code[pc];
+            switch (inst.op) {
+                case Opcode::Byte:
+                case Opcode::Any:
+                case Opcode::Class: {
+                    const Instruction& next = code[pc + 1];
+
+                    // x+ : consume the whole run at once, shortening on backtrack
+                    if (next.op == Opcode::Split && next.x == pc && next.y == pc + 2) {
+                        int run = run_length(inst, pos, length);
+                        if (run == 0) {
+                            failed = true;
+                            break;
+                        }
+                        if (run > 1) stack_.push_back({JobKind::Shorten, pc + 2, pos + run - 1, pos + 1});
+                        pos += run;
+                        pc += 2;
+                        break;
+                    }
+                    if (run_length(inst, pos, 1) == 0) {
+                        failed = true;
+                        break;
+                    }
+                    pos++;
+                    pc++;
+                    break;
+                }
+                case Opcode::Split: {
+                    // x* : same run handling for a single-byte body
+                    const Instruction& body = code[pc + 1];
+                    if (inst.x == pc + 1 && is_single_byte(body.op) &&
+                        code[pc + 2].op == Opcode::Jump && code[pc + 2].x == pc) {
+                        int run = run_length(body, pos, length);
+                        if (run > 0) stack_.push_back({JobKind::Shorten, inst.y, pos + run - 1, pos});
+                        pos += run;
+                        pc = inst.y;
+                        break;
+                    }
+                    // Remembering states where paths branch is enough to bound the search
+                    if (!visit(pc, pos)) {
+                        failed = true;
+                        break;
+                    }
+                    stack_.push_back({JobKind::Run, inst.y, pos, 0});
+                    pc = inst.x;
+                    break;
+                }
+                case Opcode::Jump:
+                    pc = inst.x;
+                    break;
+                case Opcode::Save:
+                    stack_.push_back({JobKind::RestoreSlot, inst.x, slots_[inst.x], 0});
+                    slots_[inst.x] = pos;
+                    pc++;
+                    break;
+                case Opcode::RepeatStart:
+                    stack_.push_back({JobKind::RestoreLoop, inst.x, loop_positions_[inst.x], 0});
+                    loop_positions_[inst.x] = pos;
+                    pc++;
+                    break;
+                case Opcode::RepeatCheck:
+                    // An iteration that consumed nothing must not loop again
+                    pc = (loop_positions_[inst.x] == pos) ? inst.y : pc + 1;
+                    break;
+                case Opcode::AssertStart:
+                    failed = (pos != 0);
+                    pc++;
+                    break;
+                case Opcode::AssertEnd:
+                    failed = (pos != length);
+                    pc++;
+                    break;
+                case Opcode::Backref: {
+                    if (2 * inst.x + 3 >= program_->slot_count) {
+                        failed = true; // no such group
+                        break;
+                    }
+                    int begin = slots_[2 * inst.x + 2];
+                    int end = slots_[2 * inst.x + 3];
+                    if (begin < 0 || end < begin) {
+                        failed = true; // group did not participate
+                        break;
+                    }
+                    int captured = end - begin;
+                    if (pos + captured > length || std::memcmp(input_.data() + begin, input_.data() + pos, captured) != 0) {
+                        failed = true;
+                        break;
+                    }
+                    pos += captured;
+                    pc++;
+                    break;
+                }
+                case Opcode::Match:
+                    return BacktrackResult::Match;
+            }
+        }
+    }
+    return BacktrackResult::NoMatch;
+}
+
+BacktrackResult Backtracker::search(const Program& program, std::string_view input, bool anchored_start,
+                                   size_t step_limit, int* slots) {
+    if (program_id_ != program.id) {
+        prepare(program);
+    }
+    program_ = &program;
+    input_ = input;
+    slots_.resize(program.slot_count);
+    loop_positions_.resize(program.loop_count);
+    steps_left_ = step_limit > 0 ? step_limit : SIZE_MAX;
+
+    // Failures are independent of the start offset, so the bitset is shared by all starts
+    visited_stride_ = input.size() + 1;
+    size_t bits = memo_row_count_ * visited_stride_;
+    if (bits > 0 && bits / 8 <= visited_budget_) {
+        visited_.assign((bits + 63) / 64, 0);
+    } else {
+        visited_.clear();
+    }
+
+    const size_t step_budget = steps_left_;
+    BacktrackResult result = BacktrackResult::NoMatch;
+    int last_start = anchored_start ? 0 : static_cast<int>(input.size());
+    int start = 0;
+    for (; start <= last_start && result == BacktrackResult::NoMatch; start++) {
+        result = try_at(start);
+    }
+    if (result == BacktrackResult::Match && slots) {
+        std::copy(slots_.begin(), slots_.end(), slots);
+    }
+
+    count_stat(Stat::BacktrackSteps, step_budget - steps_left_);
+    count_stat(Stat::BacktrackStarts, start);
+    return result;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "program.hpp"
+
+// Outcome of a backtracking search; StepLimit means the line was abandoned
+enum class BacktrackResult { Match, NoMatch, StepLimit };
+
+// Depth-first search over a Program with an explicit job stack. Supports
+// backreferences, which the automaton engines cannot. Captures are offset
+// pairs in a fixed slot array and every buffer is kept between searches, so
+// matching does not allocate once the buffers have grown to size.
+//
+// Failed (instruction, offset) states are remembered in a bitset so each is
+// explored at most once. Only instructions from which no backreference can be
+// reached are remembered, since elsewhere the outcome depends on the captures.
+// The bitset is skipped when it would exceed its memory budget, and a step
+// limit bounds the work spent on any one input.
+class Backtracker {
+public:
+    static constexpr size_t kDefaultVisitedBudget = 1 << 20;
+
+    explicit Backtracker(size_t visited_budget = kDefaultVisitedBudget) : visited_budget_(visited_budget) {}
+
+    // Search input for the leftmost match, giving up after step_limit
+    // instructions (0 for no limit). When slots is non-null it receives
+    // program.slot_count capture offsets (-1 for unset groups).
+    BacktrackResult search(const Program& program, std::string_view input, bool anchored_start, size_t step_limit,
+                           int* slots = nullptr);
+
+private:
+    enum class JobKind : uint8_t {
+        Run,          // resume at pc, pos
+        Shorten,      // resume at pc with one byte less of a greedy run, down to limit
+        RestoreSlot,  // undo a Save on the way back
+        RestoreLoop   // undo a RepeatStart on the way back
+    };
+
+    struct Job {
+        JobKind kind;
+        int pc;     // or slot index for Restore jobs
+        int pos;    // or previous value for Restore jobs
+        int limit;  // shortest run end for Shorten jobs
+    };
+
+    void prepare(const Program& program);
+    BacktrackResult try_at(int start);
+    int run_length(const Instruction& inst, int pos, int max_length) const;
+    bool visit(int pc, int pos);
+
+    const Program* program_ = nullptr;
+    uint64_t program_id_ = 0;
+    std::string_view input_;
+    size_t visited_budget_;
+    size_t steps_left_ = 0;
+
+    std::vector<Job> stack_;
+    std::vector<int> slots_;
+    std::vector<int> loop_positions_;
+    std::vector<int> memo_rows_;     // per pc: row in visited_, -1 if a backreference is reachable
+    int memo_row_count_ = 0;
+    std::vector<uint64_t> visited_;  // one row of bits over input offsets per memoized pc
+    size_t visited_stride_ = 0;
+};
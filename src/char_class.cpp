@@ -0,0 +1,124 @@
+#include "char_class.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+#define GREP_HAVE_SHUFFLE_DISPATCH 1
+#endif
+
+void CharClass::set_range(unsigned char first, unsigned char last) {
+    for (int c = first; c <= last; c++) {
+        bits.set(c);
+    }
+}
+
+void CharClass::build_tables() {
+    low_rows.fill(0);
+    high_rows.fill(0);
+    for (int c = 0; c < 256; c++) {
+        if (!bits[c]) continue;
+        int low = c & 0x0F;
+        int high = c >> 4;
+        if (high < 8) low_rows[low] |= static_cast<uint8_t>(1 << high);
+        else high_rows[low] |= static_cast<uint8_t>(1 << (high - 8));
+    }
+}
+
+CharClass digit_class() {
+    CharClass char_class;
+    char_class.set_range('0', '9');
+    char_class.build_tables();
+    return char_class;
+}
+
+CharClass word_class() {
+    CharClass char_class;
+    char_class.set_range('a', 'z');
+    char_class.set_range('A', 'Z');
+    char_class.set_range('0', '9');
+    char_class.set('_');
+    char_class.build_tables();
+    return char_class;
+}
+
+size_t span_scalar(const CharClass& char_class, const char* data, size_t length) {
+    size_t i = 0;
+    while (i < length && char_class.test(static_cast<unsigned char>(data[i]))) {
+        i++;
+    }
+    return i;
+}
+
+#ifdef GREP_HAVE_SHUFFLE_DISPATCH
+// Mula's nibble lookup: the low nibble selects a table row, the high nibble a bit in it
+__attribute__((target("ssse3")))
+size_t span_ssse3(const CharClass& char_class, const char* data, size_t length) {
+    const __m128i low_rows = _mm_load_si128(reinterpret_cast<const __m128i*>(char_class.low_rows.data()));
+    const __m128i high_rows = _mm_load_si128(reinterpret_cast<const __m128i*>(char_class.high_rows.data()));
+    const __m128i bit_for_nibble = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    const __m128i seven = _mm_set1_epi8(7);
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i low = _mm_and_si128(input, nibble_mask);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), nibble_mask);
+
+        __m128i use_high = _mm_cmpgt_epi8(high, seven);
+        __m128i row = _mm_or_si128(_mm_andnot_si128(use_high, _mm_shuffle_epi8(low_rows, low)),
+                                   _mm_and_si128(use_high, _mm_shuffle_epi8(high_rows, low)));
+        __m128i hit = _mm_and_si128(row, _mm_shuffle_epi8(bit_for_nibble, high));
+
+        unsigned misses = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(hit, zero)));
+        if (misses != 0) {
+            return i + __builtin_ctz(misses);
+        }
+    }
+    return i + span_scalar(char_class, data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+size_t span_avx2(const CharClass& char_class, const char* data, size_t length) {
+    const __m256i low_rows = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(char_class.low_rows.data())));
+    const __m256i high_rows = _mm256_broadcastsi128_si256(
+        _mm_load_si128(reinterpret_cast<const __m128i*>(char_class.high_rows.data())));
+    const __m256i bit_for_nibble = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                    1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+    const __m256i seven = _mm256_set1_epi8(7);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i low = _mm256_and_si256(input, nibble_mask);
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble_mask);
+
+        __m256i use_high = _mm256_cmpgt_epi8(high, seven);
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(low_rows, low),
+                                         _mm256_shuffle_epi8(high_rows, low), use_high);
+        __m256i hit = _mm256_and_si256(row, _mm256_shuffle_epi8(bit_for_nibble, high));
+
+        unsigned misses = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hit, zero)));
+        if (misses != 0) {
+            return i + __builtin_ctz(misses);
+        }
+    }
+    return i + span_ssse3(char_class, data + i, length - i);
+}
+#endif
+
+size_t CharClass::span(const char* data, size_t length) const {
+#ifdef GREP_HAVE_SHUFFLE_DISPATCH
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    if (has_avx2) return span_avx2(*this, data, length);
+    if (has_ssse3) return span_ssse3(*this, data, length);
+#endif
+    return span_scalar(*this, data, length);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+// 256-entry membership table for a character class, plus nibble-indexed
+// tables that let SIMD code test 16/32 bytes per instruction batch
+struct CharClass {
+    std::bitset<256> bits;
+
+    bool test(unsigned char c) const { return bits[c]; }
+    void set(unsigned char c) { bits.set(c); }
+    void set_range(unsigned char first, unsigned char last);
+
+    // Rebuild the SIMD tables; call after the last change to bits
+    void build_tables();
+
+    // Number of leading bytes of data that belong to the class
+    size_t span(const char* data, size_t length) const;
+
+    // Row i holds, for low nibble i, bit h set when byte (h << 4 | i) is a member;
+    // low_rows covers high nibbles 0-7 and high_rows covers 8-15
+    alignas(16) std::array<uint8_t, 16> low_rows{};
+    alignas(16) std::array<uint8_t, 16> high_rows{};
+};
+
+// Classes for the \d and \w shorthands
+CharClass digit_class();
+CharClass word_class();
@@ -0,0 +1,209 @@
+#include "decompress_stage.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "stats.hpp"
+
+// Blocks kept for reuse once their input is done
+struct DecompressBuffers {
+    std::mutex mutex;
+    std::vector<std::vector<char>> spares;
+    size_t max_spares = 0;
+};
+
+// One input shared by the stage thread decompressing it and the stream reading it
+struct DecompressJob {
+    std::string_view data;
+    Compression format = Compression::None;
+    std::shared_ptr<DecompressBuffers> buffers;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::vector<char>> blocks;
+    std::deque<int> free_blocks;                // owned by nobody, for the stage thread to fill
+    std::deque<std::pair<int, size_t>> ready;   // block, and the length of the lines in it
+    bool finished = false;                      // the stage thread has published its last block
+    std::atomic<bool> cancelled{false};
+    std::string error;
+};
+
+DecompressedStream::~DecompressedStream() {
+    DecompressJob& job = *job_;
+    {
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.cancelled = true;
+        job.changed.notify_all();
+        job.changed.wait(lock, [&] { return job.finished; });
+    }
+
+    std::lock_guard<std::mutex> lock(job.buffers->mutex);
+    for (std::vector<char>& block : job.blocks) {
+        if (job.buffers->spares.size() < job.buffers->max_spares) job.buffers->spares.push_back(std::move(block));
+    }
+}
+
+bool DecompressedStream::next(std::string_view& lines) {
+    DecompressJob& job = *job_;
+    std::unique_lock<std::mutex> lock(job.mutex);
+    if (held_ >= 0) {
+        job.free_blocks.push_back(held_);
+        held_ = -1;
+        job.changed.notify_all();
+    }
+    job.changed.wait(lock, [&] { return !job.ready.empty() || job.finished; });
+    if (job.ready.empty()) {
+        return false;
+    }
+    auto [block, length] = job.ready.front();
+    job.ready.pop_front();
+    held_ = block;
+    lines = std::string_view(job.blocks[block].data(), length);
+    return true;
+}
+
+std::string DecompressedStream::error() const {
+    std::lock_guard<std::mutex> lock(job_->mutex);
+    return job_->error;
+}
+
+DecompressStage::DecompressStage(int threads) : buffers_(std::make_shared<DecompressBuffers>()) {
+    buffers_->max_spares = static_cast<size_t>(threads) * kDecompressBlocksAhead;
+    for (int i = 0; i < threads; i++) {
+        threads_.emplace_back([this] { run(); });
+    }
+}
+
+DecompressStage::~DecompressStage() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_all();
+    for (std::thread& thread : threads_) thread.join();
+}
+
+std::unique_ptr<DecompressedStream> DecompressStage::open(std::string_view data, Compression format) {
+    auto job = std::make_shared<DecompressJob>();
+    job->data = data;
+    job->format = format;
+    job->buffers = buffers_;
+    job->blocks.resize(kDecompressBlocksAhead);
+    {
+        std::lock_guard<std::mutex> lock(buffers_->mutex);
+        for (std::vector<char>& block : job->blocks) {
+            if (buffers_->spares.empty()) break;
+            block = std::move(buffers_->spares.back());
+            buffers_->spares.pop_back();
+        }
+    }
+    for (size_t i = 0; i < job->blocks.size(); i++) {
+        job->free_blocks.push_back(static_cast<int>(i));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(job);
+    }
+    queued_.notify_one();
+    return std::make_unique<DecompressedStream>(std::move(job));
+}
+
+void DecompressStage::run() {
+    for (;;) {
+        std::shared_ptr<DecompressJob> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queued_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        decompress(*job);
+
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished = true;
+        job->changed.notify_all();
+    }
+}
+
+// Block the reader has handed back, or -1 once it has gone away
+int take_free_block(DecompressJob& job) {
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.changed.wait(lock, [&] { return !job.free_blocks.empty() || job.cancelled; });
+    if (job.cancelled) return -1;
+    int block = job.free_blocks.front();
+    job.free_blocks.pop_front();
+    return block;
+}
+
+void publish_block(DecompressJob& job, int block, size_t length) {
+    std::lock_guard<std::mutex> lock(job.mutex);
+    job.ready.emplace_back(block, length);
+    job.changed.notify_all();
+}
+
+// Fill blocks until each is full, then pass on everything up to its last
+// newline and start the next block with the rest
+void DecompressStage::decompress(DecompressJob& job) {
+    count_stat(Stat::CompressedFiles);
+    Decompressor decompressor(job.format);
+    std::string_view input = job.data;
+    int current = take_free_block(job);
+    size_t used = 0;
+    size_t searched = 0; // bytes of the current block known to hold no newline
+
+    while (current >= 0 && !job.cancelled) {
+        std::vector<char>& block = job.blocks[current];
+        if (block.size() < kDecompressBlockSize) {
+            block.resize(kDecompressBlockSize);
+        } else if (used == block.size()) {
+            block.resize(block.size() * 2); // a line longer than a block
+        }
+
+        size_t produced = 0;
+        bool decoded;
+        {
+            StatTimer timer(Stat::DecompressNanos);
+            decoded = decompressor.decode(input, block.data() + used, block.size() - used, produced);
+        }
+        used += produced;
+        count_stat(Stat::DecompressedBytes, produced);
+        if (!decoded) {
+            if (used > 0) publish_block(job, current, used); // what could be read before the damage
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.error = decompressor.error();
+            break;
+        }
+        if (decompressor.finished()) {
+            if (used > 0) publish_block(job, current, used);
+            break;
+        }
+        if (used < block.size()) {
+            continue;
+        }
+
+        const void* newline = memrchr(block.data() + searched, '\n', used - searched);
+        if (!newline) {
+            searched = used;
+            continue;
+        }
+        size_t end = static_cast<const char*>(newline) - block.data() + 1;
+        int next = take_free_block(job);
+        if (next < 0) {
+            break;
+        }
+        std::vector<char>& next_block = job.blocks[next];
+        size_t tail = used - end;
+        if (next_block.size() < std::max(kDecompressBlockSize, tail * 2)) {
+            next_block.resize(std::max(kDecompressBlockSize, tail * 2));
+        }
+        std::memcpy(next_block.data(), block.data() + end, tail);
+        publish_block(job, current, end);
+
+        current = next;
+        used = tail;
+        searched = tail;
+    }
+}
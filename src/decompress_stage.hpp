@@ -0,0 +1,71 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "decompressor.hpp"
+
+// Decompressed bytes per block handed to the matcher, before the unfinished last line is cut off
+constexpr size_t kDecompressBlockSize = 1 << 20;
+
+// Blocks one input may have decompressed ahead of its reader
+constexpr size_t kDecompressBlocksAhead = 4;
+
+struct DecompressBuffers;
+struct DecompressJob;
+
+// Reader side of one input being decompressed. Blocks come out as runs of
+// whole lines; only the unfinished line at the end of a block is copied into
+// the next one. Destroying the stream early stops the decompression.
+class DecompressedStream {
+public:
+    explicit DecompressedStream(std::shared_ptr<DecompressJob> job) : job_(std::move(job)) {}
+    ~DecompressedStream();
+
+    DecompressedStream(const DecompressedStream&) = delete;
+    DecompressedStream& operator=(const DecompressedStream&) = delete;
+
+    // Next run of lines, waiting for it to be decompressed. The view stays
+    // valid until the following call. False at the end of the data or on an error.
+    bool next(std::string_view& lines);
+
+    // Why decompression stopped early; empty if it did not
+    std::string error() const;
+
+private:
+    std::shared_ptr<DecompressJob> job_;
+    int held_ = -1;  // block the last view points into
+};
+
+// Threads that decompress inputs while the threads that opened them match
+// what has been decompressed so far. Buffers are recycled across inputs, so
+// memory is bounded by kDecompressBlocksAhead blocks per active input.
+class DecompressStage {
+public:
+    explicit DecompressStage(int threads);
+    ~DecompressStage();
+
+    DecompressStage(const DecompressStage&) = delete;
+    DecompressStage& operator=(const DecompressStage&) = delete;
+
+    // Start decompressing data, which must stay mapped until the stream is destroyed
+    std::unique_ptr<DecompressedStream> open(std::string_view data, Compression format);
+
+private:
+    void run();
+    void decompress(DecompressJob& job);
+
+    std::mutex mutex_;
+    std::condition_variable queued_;
+    std::deque<std::shared_ptr<DecompressJob>> jobs_;
+    bool stopping_ = false;
+    std::shared_ptr<DecompressBuffers> buffers_;  // also held by jobs, which return their blocks to it
+    std::vector<std::thread> threads_;
+};
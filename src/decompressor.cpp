@@ -0,0 +1,151 @@
+#include "decompressor.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#ifdef GREP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GREP_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+constexpr std::string_view kGzipMagic = "\x1f\x8b";
+constexpr std::string_view kZstdMagic = "\x28\xb5\x2f\xfd";
+
+Compression detect_compression(std::string_view data) {
+    if (data.starts_with(kGzipMagic)) return Compression::Gzip;
+    if (data.starts_with(kZstdMagic)) return Compression::Zstd;
+    return Compression::None;
+}
+
+const char* compression_name(Compression format) {
+    switch (format) {
+        case Compression::Gzip: return "gzip";
+        case Compression::Zstd: return "zstd";
+        case Compression::None: break;
+    }
+    return "none";
+}
+
+bool compression_supported(Compression format) {
+    switch (format) {
+#ifdef GREP_HAVE_ZLIB
+        case Compression::Gzip: return true;
+#endif
+#ifdef GREP_HAVE_ZSTD
+        case Compression::Zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+// Library state of whichever format is being decoded
+struct Decompressor::State {
+#ifdef GREP_HAVE_ZLIB
+    z_stream gzip{};
+    bool gzip_ready = false;
+#endif
+#ifdef GREP_HAVE_ZSTD
+    ZSTD_DStream* zstd = nullptr;
+#endif
+
+    ~State() {
+#ifdef GREP_HAVE_ZLIB
+        if (gzip_ready) inflateEnd(&gzip);
+#endif
+#ifdef GREP_HAVE_ZSTD
+        if (zstd) ZSTD_freeDStream(zstd);
+#endif
+    }
+};
+
+Decompressor::Decompressor(Compression format) : format_(format), state_(std::make_unique<State>()) {
+    if (!compression_supported(format)) {
+        error_ = std::string("Decompressing ") + compression_name(format) + " is not supported by this build";
+        return;
+    }
+#ifdef GREP_HAVE_ZLIB
+    if (format == Compression::Gzip) {
+        // 32 adds automatic gzip header detection to the default window size
+        state_->gzip_ready = inflateInit2(&state_->gzip, 15 + 32) == Z_OK;
+        if (!state_->gzip_ready) error_ = "Could not initialise zlib";
+    }
+#endif
+#ifdef GREP_HAVE_ZSTD
+    if (format == Compression::Zstd) {
+        state_->zstd = ZSTD_createDStream();
+        if (!state_->zstd || ZSTD_isError(ZSTD_initDStream(state_->zstd))) error_ = "Could not initialise zstd";
+    }
+#endif
+}
+
+Decompressor::~Decompressor() = default;
+
+bool Decompressor::decode(std::string_view& input, char* out, size_t capacity, size_t& produced) {
+    produced = 0;
+    if (!error_.empty()) {
+        return false;
+    }
+    if (finished_ || capacity == 0) {
+        return true;
+    }
+
+#ifdef GREP_HAVE_ZLIB
+    if (format_ == Compression::Gzip) {
+        z_stream& stream = state_->gzip;
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = static_cast<uInt>(std::min<size_t>(input.size(), UINT_MAX));
+        stream.next_out = reinterpret_cast<Bytef*>(out);
+        stream.avail_out = static_cast<uInt>(std::min<size_t>(capacity, UINT_MAX));
+        uInt offered_in = stream.avail_in;
+        uInt offered_out = stream.avail_out;
+
+        int status = inflate(&stream, Z_NO_FLUSH);
+        input.remove_prefix(offered_in - stream.avail_in);
+        produced = offered_out - stream.avail_out;
+
+        if (status == Z_STREAM_END) {
+            // Another member may follow; anything else after the last one is ignored, as gzip -d does
+            if (input.starts_with(kGzipMagic)) inflateReset(&stream);
+            else finished_ = true;
+            return true;
+        }
+        if (status == Z_OK || (status == Z_BUF_ERROR && produced > 0)) {
+            if (input.empty() && stream.avail_out > 0) {
+                error_ = "Unexpected end of gzip data";
+                return false;
+            }
+            return true;
+        }
+        error_ = std::string("Corrupt gzip data") + (stream.msg ? std::string(": ") + stream.msg : "");
+        return false;
+    }
+#endif
+#ifdef GREP_HAVE_ZSTD
+    if (format_ == Compression::Zstd) {
+        ZSTD_inBuffer in{input.data(), input.size(), 0};
+        ZSTD_outBuffer output{out, capacity, 0};
+        size_t status = ZSTD_decompressStream(state_->zstd, &output, &in);
+        if (ZSTD_isError(status)) {
+            error_ = std::string("Corrupt zstd data: ") + ZSTD_getErrorName(status);
+            return false;
+        }
+        input.remove_prefix(in.pos);
+        produced = output.pos;
+
+        // Frames follow one another; the input ends on a frame boundary when status is 0
+        if (input.empty() && output.pos < output.size) {
+            if (status != 0) {
+                error_ = "Unexpected end of zstd data";
+                return false;
+            }
+            finished_ = true;
+        }
+        return true;
+    }
+#endif
+    (void)input;
+    (void)out;
+    return false;
+}
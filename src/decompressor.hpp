@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Formats -z recognises by their leading magic bytes
+enum class Compression {
+    None,
+    Gzip,  // also multi-member files such as those from pigz
+    Zstd
+};
+
+Compression detect_compression(std::string_view data);
+
+const char* compression_name(Compression format);
+
+// Whether this build was linked with the library for a format
+bool compression_supported(Compression format);
+
+// Incremental decoder for one compressed input, which may hold several
+// concatenated gzip members or zstd frames
+class Decompressor {
+public:
+    explicit Decompressor(Compression format);
+    ~Decompressor();
+
+    Decompressor(const Decompressor&) = delete;
+    Decompressor& operator=(const Decompressor&) = delete;
+
+    // Decode from the front of input into out, dropping the bytes consumed.
+    // Returns false with error() set on corrupt or truncated data.
+    bool decode(std::string_view& input, char* out, size_t capacity, size_t& produced);
+
+    // True once the last member or frame has ended
+    bool finished() const { return finished_; }
+
+    const std::string& error() const { return error_; }
+
+private:
+    struct State;
+
+    Compression format_;
+    std::unique_ptr<State> state_;
+    bool finished_ = false;
+    std::string error_;
+};
@@ -0,0 +1,184 @@
+#include "directory_walker.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "input.hpp"
+#include "stats.hpp"
+
+// Bytes of directory records fetched per getdents64 call
+constexpr size_t kDirentBufferSize = 64 << 10;
+
+enum class EntryType { Skip, File, Directory };
+
+// Classify an entry from its d_type, calling fstatat() only for symlinks and
+// file systems that do not fill d_type in
+EntryType entry_type(int dir_fd, const char* name, unsigned char d_type) {
+    if (d_type == DT_DIR) return EntryType::Directory;
+    if (d_type == DT_REG) return EntryType::File;
+    if (d_type != DT_LNK && d_type != DT_UNKNOWN) return EntryType::Skip;
+
+    struct stat info;
+    if (d_type == DT_UNKNOWN) {
+        if (fstatat(dir_fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0) return EntryType::Skip;
+        if (S_ISDIR(info.st_mode)) return EntryType::Directory;
+        if (S_ISREG(info.st_mode)) return EntryType::File;
+        if (!S_ISLNK(info.st_mode)) return EntryType::Skip;
+    }
+    // A symlink counts as a file when it leads to one; linked directories are not followed
+    if (fstatat(dir_fd, name, &info, 0) != 0) return EntryType::Skip;
+    return S_ISREG(info.st_mode) ? EntryType::File : EntryType::Skip;
+}
+
+std::string system_error_message(const char* what, const std::string& path) {
+    return std::string("Filesystem error: ") + what + " '" + path + "': " + std::strerror(errno);
+}
+
+DirectoryWalker::DirectoryWalker(const WalkOptions& options, FileHandler on_file, ErrorHandler on_error)
+    : options_(options), on_file_(std::move(on_file)), on_error_(std::move(on_error)) {}
+
+bool DirectoryWalker::walk(const std::string& root) {
+    int fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        on_error_(system_error_message("cannot open directory", root));
+        return true;
+    }
+    bool keep_going = walk_directory(fd, root);
+    ::close(fd);
+    return keep_going;
+}
+
+bool DirectoryWalker::walk_directory(int fd, const std::string& path) {
+    StatTimer timer(Stat::TraversalNanos);
+    std::vector<Entry> entries;
+    bool has_ignore_files = false;
+    if (!read_entries(fd, path, entries, has_ignore_files)) {
+        return true;
+    }
+
+    size_t frames = ignore_stack_.size();
+    if (options_.use_ignore_files && has_ignore_files) {
+        load_ignore_files(fd, path);
+    }
+
+    std::string prefix = (!path.empty() && path.back() == '/') ? path : path + "/";
+    std::erase_if(entries, [&](const Entry& entry) {
+        return excluded(prefix + entry.name, entry.name, entry.is_directory);
+    });
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+    timer.stop(); // subdirectories and visited files are timed on their own
+
+    bool keep_going = true;
+    for (const Entry& entry : entries) {
+        std::string child = prefix + entry.name;
+        if (entry.is_directory) {
+            int child_fd = ::openat(fd, entry.name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child_fd < 0) {
+                on_error_(system_error_message("cannot open directory", child));
+                continue;
+            }
+            keep_going = walk_directory(child_fd, child);
+            ::close(child_fd);
+        } else {
+            keep_going = on_file_(child);
+        }
+        if (!keep_going) break;
+    }
+
+    ignore_stack_.resize(frames);
+    return keep_going;
+}
+
+bool DirectoryWalker::read_entries(int fd, const std::string& path, std::vector<Entry>& entries,
+                                   bool& has_ignore_files) {
+    auto add_entry = [&](const char* name, unsigned char d_type) {
+        if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) return;
+        if (std::strcmp(name, ".gitignore") == 0 || std::strcmp(name, ".ignore") == 0) has_ignore_files = true;
+        EntryType type = entry_type(fd, name, d_type);
+        if (type == EntryType::Skip) return;
+        bool is_directory = (type == EntryType::Directory);
+        entries.push_back({is_directory ? std::string(name) + "/" : std::string(name), name, is_directory});
+    };
+
+#ifdef __linux__
+    alignas(struct dirent64) static thread_local char buffer[kDirentBufferSize];
+    for (;;) {
+        long count = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            on_error_(system_error_message("cannot read directory", path));
+            return false;
+        }
+        if (count == 0) break;
+        for (long offset = 0; offset < count;) {
+            const struct dirent64* record = reinterpret_cast<const struct dirent64*>(buffer + offset);
+            add_entry(record->d_name, record->d_type);
+            offset += record->d_reclen;
+        }
+    }
+#else
+    // readdir() still reports d_type; it needs a descriptor of its own
+    DIR* dir = fdopendir(::dup(fd));
+    if (!dir) {
+        on_error_(system_error_message("cannot read directory", path));
+        return false;
+    }
+    while (const struct dirent* record = readdir(dir)) {
+        add_entry(record->d_name, record->d_type);
+    }
+    closedir(dir);
+#endif
+    return true;
+}
+
+void DirectoryWalker::load_ignore_files(int fd, const std::string& path) {
+    IgnoreFrame frame;
+    frame.base_length = (!path.empty() && path.back() == '/') ? path.size() : path.size() + 1;
+    for (const char* name : {".gitignore", ".ignore"}) {
+        int file_fd = ::openat(fd, name, O_RDONLY | O_CLOEXEC);
+        if (file_fd < 0) continue;
+        InputFile file;
+        if (file.open_fd(file_fd)) {
+            frame.rules.add_rules(file.contents());
+        }
+        ::close(file_fd);
+    }
+    if (!frame.rules.empty()) {
+        ignore_stack_.push_back(std::move(frame));
+    }
+}
+
+bool DirectoryWalker::excluded(const std::string& path, const std::string& name, bool is_directory) const {
+    if (is_directory) {
+        if (name == ".git") return true;
+        for (const std::string& glob : options_.exclude_dir_globs) {
+            if (glob_match(glob, name)) return true;
+        }
+    } else {
+        if (!options_.include_globs.empty() &&
+            std::none_of(options_.include_globs.begin(), options_.include_globs.end(),
+                         [&](const std::string& glob) { return glob_match(glob, name); })) {
+            return true;
+        }
+        for (const std::string& glob : options_.exclude_globs) {
+            if (glob_match(glob, name)) return true;
+        }
+    }
+
+    // The innermost ignore file with an opinion decides
+    for (auto it = ignore_stack_.rbegin(); it != ignore_stack_.rend(); ++it) {
+        IgnoreMatch match = it->rules.match(std::string_view(path).substr(it->base_length), is_directory);
+        if (match != IgnoreMatch::None) {
+            return match == IgnoreMatch::Ignore;
+        }
+    }
+    return false;
+}
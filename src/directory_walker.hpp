@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ignore_rules.hpp"
+
+// Which entries a recursive walk visits
+struct WalkOptions {
+    bool use_ignore_files = true;                // honour .gitignore and .ignore; --no-ignore turns this off
+    std::vector<std::string> include_globs;      // --include: only files whose name matches one of these
+    std::vector<std::string> exclude_globs;      // --exclude: skip files whose name matches
+    std::vector<std::string> exclude_dir_globs;  // --exclude-dir: skip directories whose name matches
+};
+
+// Depth-first directory walk that visits regular files in the order of their
+// full path strings. Directories sort as "name/", so "a.txt" comes before
+// "a/b.txt" as in a plain sort of the paths. Each directory is opened with
+// openat() relative to its parent and listed with getdents64(), whose d_type
+// spares a stat() per entry. Symlinks to files are visited; symlinked
+// directories are not followed. .git directories and anything matched by the
+// ignore files or globs are pruned before they are opened.
+class DirectoryWalker {
+public:
+    // Called for each file in order; return false to end the walk
+    using FileHandler = std::function<bool(const std::string& path)>;
+    using ErrorHandler = std::function<void(const std::string& message)>;
+
+    DirectoryWalker(const WalkOptions& options, FileHandler on_file, ErrorHandler on_error);
+
+    // Walk the tree below a directory; false once on_file has ended the walk
+    bool walk(const std::string& root);
+
+private:
+    struct Entry {
+        std::string key;  // name, with a trailing '/' for directories
+        std::string name;
+        bool is_directory;
+    };
+
+    // Ignore rules read from one directory
+    struct IgnoreFrame {
+        IgnoreRules rules;
+        size_t base_length;  // length of the directory's path prefix, separator included
+    };
+
+    bool walk_directory(int fd, const std::string& path);
+    bool read_entries(int fd, const std::string& path, std::vector<Entry>& entries, bool& has_ignore_files);
+    void load_ignore_files(int fd, const std::string& path);
+    bool excluded(const std::string& path, const std::string& name, bool is_directory) const;
+
+    const WalkOptions& options_;
+    FileHandler on_file_;
+    ErrorHandler on_error_;
+    std::vector<IgnoreFrame> ignore_stack_;
+};
@@ -0,0 +1,270 @@
+#include "file_scanner.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include "search.hpp"
+#include "stats.hpp"
+
+// Output of a unit is handed to OrderedOutput in chunks of about this size
+constexpr size_t kOutputChunkSize = 64 << 10;
+
+// End of the chunk that starts at start: just past the first newline at least
+// kParallelChunkSize bytes on, so no line straddles two chunks
+size_t chunk_end(std::string_view contents, size_t start) {
+    if (contents.size() - start <= kParallelChunkSize) {
+        return contents.size();
+    }
+    size_t newline = contents.find('\n', start + kParallelChunkSize - 1);
+    return (newline == std::string_view::npos) ? contents.size() : newline + 1;
+}
+
+bool looks_binary(std::string_view contents) {
+    return std::memchr(contents.data(), '\0', std::min(contents.size(), kBinaryCheckBytes)) != nullptr;
+}
+
+FileScanner::FileScanner(const CompiledPattern& compiled, int jobs, size_t window, OutputWriter& writer,
+                         OpenErrorHandler on_open_error, ReportOptions report, ScanOptions scan)
+    : compiled_(compiled),
+      report_(report),
+      scan_(scan),
+      prefetcher_(scan.prefetch),
+      decompress_(scan.decompress ? std::make_unique<DecompressStage>(std::max(jobs, 1)) : nullptr),
+      output_(writer, window),
+      line_buffered_(writer.line_buffered()),
+      on_open_error_(std::move(on_open_error)),
+      pool_(jobs) {}
+
+void FileScanner::add_file(const std::string& path, std::string prefix) {
+    if (stopped()) {
+        return;
+    }
+
+    // Only plain line output can be stitched together from independent chunks
+    bool splittable = report_.mode == ReportMode::Lines && report_.max_count == kNoMaxCount;
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    bool split = splittable && !error && pool_.size() > 1 && size > kParallelChunkSize;
+
+    if (!split) {
+        size_t unit = output_.begin_file(); // may wait for earlier units to drain
+        uint64_t prefetched = error ? 0 : size;
+        if (prefetched > 0) prefetcher_.add(path, prefetched);
+        pool_.submit([this, unit, path, prefix = std::move(prefix), prefetched] {
+            scan_whole(unit, path, prefix, prefetched);
+        });
+        return;
+    }
+
+    // Map the file here so its chunks can be numbered in order
+    auto shared = std::make_shared<SplitFile>();
+    if (!open_input(shared->file, path)) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        on_open_error_(path);
+        return;
+    }
+    bool compressed = scan_.decompress && detect_compression(shared->file.contents()) != Compression::None;
+    if (compressed || (report_.binary_files != BinaryFiles::Text && looks_binary(shared->file.contents()))) {
+        // Compressed and binary files are read as a whole, so there is nothing to gain from chunks
+        size_t unit = output_.begin_file();
+        pool_.submit([this, unit, shared, path, prefix = std::move(prefix)] {
+            if (stopped()) {
+                output_.finish(unit);
+                return;
+            }
+            scan_opened(unit, shared->file, path, prefix);
+        });
+        return;
+    }
+    shared->path = path;
+    shared->prefix = std::move(prefix);
+
+    std::string_view contents = shared->file.contents();
+    size_t chunk_count = 0;
+    for (size_t start = 0; start < contents.size(); start = chunk_end(contents, start)) {
+        chunk_count++;
+    }
+    shared->chunks_left = chunk_count;
+
+    for (size_t start = 0; start < contents.size();) {
+        size_t end = chunk_end(contents, start);
+        std::string_view chunk = contents.substr(start, end - start);
+        size_t unit = output_.begin_file();
+        pool_.submit([this, unit, shared, chunk] { scan_chunk(unit, shared, chunk); });
+        start = end;
+    }
+}
+
+// Open and load a file, counting it for --stats
+bool FileScanner::open_input(InputFile& file, const std::string& path) {
+    StatTimer timer(Stat::IoNanos);
+    if (!file.open(path)) {
+        count_stat(Stat::FilesSkipped);
+        return false;
+    }
+    count_stat(Stat::FilesOpened);
+    count_stat(Stat::BytesRead, file.contents().size());
+    return true;
+}
+
+void FileScanner::scan_whole(size_t unit, const std::string& path, const std::string& prefix,
+                             uint64_t prefetched) {
+    prefetcher_.consumed(prefetched);
+    if (stopped()) {
+        output_.finish(unit);
+        return;
+    }
+    InputFile file;
+    if (!open_input(file, path)) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            on_open_error_(path);
+        }
+        output_.finish(unit);
+        return; // Continue with other files
+    }
+    scan_opened(unit, file, path, prefix);
+}
+
+// Scan a file open_input has already loaded and counted
+void FileScanner::scan_opened(size_t unit, const InputFile& file, const std::string& path,
+                              const std::string& prefix) {
+    if (scan_.decompress) {
+        Compression format = detect_compression(file.contents());
+        if (format != Compression::None && compression_supported(format)) {
+            scan_compressed(unit, file.contents(), format, path, prefix);
+            return;
+        }
+        if (format != Compression::None) {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            std::cerr << "Warning: '" << path << "' is " << compression_name(format)
+                      << " compressed, which this build cannot read" << std::endl;
+        }
+    }
+    bool binary = report_.binary_files != BinaryFiles::Text && looks_binary(file.contents());
+    if (binary) {
+        count_stat(Stat::BinaryFiles);
+        if (report_.binary_files == BinaryFiles::Skip) {
+            output_.finish(unit);
+            return;
+        }
+    }
+    matched_lines_ += scan_buffer(unit, file.contents(), path, prefix, binary);
+    report_skipped(path, take_skipped_lines());
+}
+
+void FileScanner::scan_chunk(size_t unit, const std::shared_ptr<SplitFile>& split, std::string_view chunk) {
+    matched_lines_ += scan_buffer(unit, chunk, split->path, split->prefix);
+    split->skipped_lines += take_skipped_lines();
+    if (--split->chunks_left == 0) {
+        report_skipped(split->path, split->skipped_lines);
+    }
+}
+
+// Match the blocks of a compressed file as the decompression stage produces them
+void FileScanner::scan_compressed(size_t unit, std::string_view data, Compression format, const std::string& path,
+                                  const std::string& prefix) {
+    std::unique_ptr<DecompressedStream> stream = decompress_->open(data, format);
+    UnitScan scan;
+    bool first = true;
+    std::string_view lines;
+    while (stream->next(lines)) {
+        if (first && report_.binary_files != BinaryFiles::Text && looks_binary(lines)) {
+            count_stat(Stat::BinaryFiles);
+            if (report_.binary_files == BinaryFiles::Skip) break;
+            scan.binary = true;
+        }
+        first = false;
+        if (!scan_lines(unit, lines, prefix, scan)) break;
+    }
+    std::string error = stream->error();
+    stream.reset(); // stops decompressing if the report was settled early
+    matched_lines_ += finish_unit(unit, path, prefix, scan);
+    if (!error.empty()) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        std::cerr << "Warning: " << error << " in '" << path << "'" << std::endl;
+    }
+    report_skipped(path, take_skipped_lines());
+}
+
+size_t FileScanner::scan_buffer(size_t unit, std::string_view buffer, const std::string& path,
+                                const std::string& prefix, bool binary) {
+    UnitScan scan;
+    scan.binary = binary;
+    scan_lines(unit, buffer, prefix, scan);
+    return finish_unit(unit, path, prefix, scan);
+}
+
+// Format matches as prefix + line and pass them on in chunks, or one by one
+// with --line-buffered. Returns false
+// once the mode has its answer for the unit. Lines of binary files are not
+// printed, only that the file matches.
+bool FileScanner::scan_lines(size_t unit, std::string_view buffer, const std::string& prefix, UnitScan& scan) {
+    if (stats_enabled()) {
+        count_stat(Stat::LinesRead, std::count(buffer.begin(), buffer.end(), '\n'));
+    }
+    if (scan.count >= report_.max_count) {
+        return false;
+    }
+
+    // Matching time excludes the output calls made along the way
+    uint64_t output_before = thread_stat(Stat::OutputNanos);
+    StatTimer timer(Stat::MatchNanos);
+    bool keep_going = for_each_matching_line(buffer, compiled_, [&](std::string_view line) {
+        scan.count++;
+        switch (report_.mode) {
+            case ReportMode::Lines:
+                if (scan.binary) {
+                    return false;
+                }
+                scan.block += prefix;
+                scan.block += line;
+                scan.block += '\n';
+                if (line_buffered_ || scan.block.size() >= kOutputChunkSize) {
+                    output_.write(unit, scan.block);
+                }
+                break;
+            case ReportMode::Count:
+                break;
+            case ReportMode::FileNames:
+                return false; // the name is all that is printed
+            case ReportMode::Quiet:
+                stopped_ = true;
+                return false;
+        }
+        return scan.count < report_.max_count && !stopped();
+    });
+    timer.exclude(thread_stat(Stat::OutputNanos) - output_before);
+    return keep_going;
+}
+
+// Add the per-file report the mode asks for and release the unit; returns the number of matches
+size_t FileScanner::finish_unit(size_t unit, const std::string& path, const std::string& prefix, UnitScan& scan) {
+    if (report_.mode == ReportMode::Count) {
+        scan.block += prefix;
+        scan.block += std::to_string(scan.count);
+        scan.block += '\n';
+    }
+    else if (report_.mode == ReportMode::FileNames && scan.count > 0) {
+        scan.block += path;
+        scan.block += '\n';
+    }
+    else if (report_.mode == ReportMode::Lines && scan.binary && scan.count > 0) {
+        scan.block += "Binary file ";
+        scan.block += path;
+        scan.block += " matches\n";
+    }
+    output_.write(unit, scan.block);
+    output_.finish(unit);
+    return scan.count;
+}
+
+void FileScanner::report_skipped(const std::string& path, size_t skipped) {
+    if (skipped > 0) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        std::cerr << "Warning: Skipped " << skipped << " line(s) in '" << path
+                  << "' that exceeded the backtracking limit" << std::endl;
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "decompress_stage.hpp"
+#include "input.hpp"
+#include "ordered_output.hpp"
+#include "output_writer.hpp"
+#include "pattern.hpp"
+#include "prefetcher.hpp"
+#include "work_stealing_pool.hpp"
+
+// Size of the newline-aligned chunks larger files are split into for parallel scanning
+constexpr size_t kParallelChunkSize = 16 << 20;
+
+// What FileScanner writes for each file
+enum class ReportMode {
+    Lines,      // every matching line
+    Count,      // -c: prefix + number of matching lines
+    FileNames,  // -l: the path of each file with a match
+    Quiet       // -q: nothing; the whole scan stops at the first match
+};
+
+// Treatment of files with a NUL byte in their first kBinaryCheckBytes
+enum class BinaryFiles {
+    Summary,  // print "Binary file PATH matches" instead of the lines
+    Skip,     // -I: never report a match
+    Text      // search like any other file
+};
+
+constexpr size_t kBinaryCheckBytes = 32 << 10;
+
+// Whether the start of a file holds a NUL byte, which text does not
+bool looks_binary(std::string_view contents);
+
+constexpr size_t kNoMaxCount = std::numeric_limits<size_t>::max();
+
+struct ReportOptions {
+    ReportMode mode = ReportMode::Lines;
+    size_t max_count = kNoMaxCount;  // -m N: stop reading a file after N matching lines
+    BinaryFiles binary_files = BinaryFiles::Summary;  // --binary-files
+};
+
+// How FileScanner reads files
+struct ScanOptions {
+    PrefetchMode prefetch = PrefetchMode::Auto;  // --prefetch
+    bool decompress = false;                     // -z: search the contents of gzip and zstd files
+};
+
+// Scans files on a work-stealing pool and writes each matching line as
+// prefix + line, in the order the files were added. Files larger than
+// kParallelChunkSize are cut into newline-aligned chunks that are scanned
+// concurrently and released in order, so output is identical to a serial scan.
+// Every worker shares the same compiled pattern. Modes other than plain lines
+// stop reading a file once its report is settled, and scan it whole. Files
+// scanned whole are read ahead by a Prefetcher while earlier ones are matched.
+// With -z, compressed files are decompressed by a DecompressStage while the
+// worker that opened them matches the blocks already decompressed.
+class FileScanner {
+public:
+    // Called with the path of a file that could not be opened
+    using OpenErrorHandler = std::function<void(const std::string& path)>;
+
+    FileScanner(const CompiledPattern& compiled, int jobs, size_t window, OutputWriter& writer,
+                OpenErrorHandler on_open_error, ReportOptions report = {}, ScanOptions scan = {});
+
+    // Queue a file; may wait while the in-flight window is full. Does nothing once stopped.
+    void add_file(const std::string& path, std::string prefix);
+
+    // Block until every queued file has been scanned and written
+    void wait() { pool_.wait(); }
+
+    size_t matched_lines() const { return matched_lines_; }
+
+    // True once -q has seen a match; queued files are then dropped unread
+    bool stopped() const { return stopped_.load(std::memory_order_relaxed); }
+
+    // Serializes messages to std::cerr with those of the scanner
+    std::mutex& error_mutex() { return error_mutex_; }
+
+private:
+    // A file being scanned as several chunks; the mapping lives until the last one is done
+    struct SplitFile {
+        InputFile file;
+        std::string path;
+        std::string prefix;
+        std::atomic<size_t> chunks_left{0};
+        std::atomic<size_t> skipped_lines{0};
+    };
+
+    // Matches found in a unit so far, and output not yet passed on
+    struct UnitScan {
+        size_t count = 0;
+        std::string block;
+        bool binary = false;
+    };
+
+    bool open_input(InputFile& file, const std::string& path);
+    void scan_whole(size_t unit, const std::string& path, const std::string& prefix, uint64_t prefetched);
+    void scan_opened(size_t unit, const InputFile& file, const std::string& path, const std::string& prefix);
+    void scan_chunk(size_t unit, const std::shared_ptr<SplitFile>& split, std::string_view chunk);
+    void scan_compressed(size_t unit, std::string_view data, Compression format, const std::string& path,
+                         const std::string& prefix);
+    size_t scan_buffer(size_t unit, std::string_view buffer, const std::string& path, const std::string& prefix,
+                       bool binary = false);
+    bool scan_lines(size_t unit, std::string_view buffer, const std::string& prefix, UnitScan& scan);
+    size_t finish_unit(size_t unit, const std::string& path, const std::string& prefix, UnitScan& scan);
+    void report_skipped(const std::string& path, size_t skipped);
+
+    const CompiledPattern& compiled_;
+    ReportOptions report_;
+    ScanOptions scan_;
+    Prefetcher prefetcher_;
+    std::unique_ptr<DecompressStage> decompress_;  // with -z
+    OrderedOutput output_;
+    bool line_buffered_;  // pass on every record as soon as it is found
+    OpenErrorHandler on_open_error_;
+    std::mutex error_mutex_;
+    std::atomic<size_t> matched_lines_{0};
+    std::atomic<bool> stopped_{false};
+    // Declared last so it is destroyed first: its destructor finishes the queued
+    // tasks and joins the workers while everything they use is still alive
+    WorkStealingPool pool_;
+};
@@ -0,0 +1,172 @@
+#include "ignore_rules.hpp"
+
+// Match a bracket expression starting at pattern[pos] == '[' against c. Sets
+// end to the offset just past ']'; returns false in end == npos when the
+// bracket is unterminated and should be taken literally.
+bool match_bracket(std::string_view pattern, size_t pos, unsigned char c, size_t& end) {
+    size_t i = pos + 1;
+    bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negated) i++;
+
+    bool matched = false;
+    bool first = true;
+    for (; i < pattern.size() && (pattern[i] != ']' || first); first = false) {
+        unsigned char low = static_cast<unsigned char>(pattern[i]);
+        if (low == '\\' && i + 1 < pattern.size()) low = static_cast<unsigned char>(pattern[++i]);
+        i++;
+        unsigned char high = low;
+        if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']') {
+            high = static_cast<unsigned char>(pattern[i + 1]);
+            if (high == '\\' && i + 2 < pattern.size()) high = static_cast<unsigned char>(pattern[++i + 1]);
+            i += 2;
+        }
+        if (c >= low && c <= high) matched = true;
+    }
+    if (i >= pattern.size()) {
+        end = std::string_view::npos;
+        return false;
+    }
+    end = i + 1;
+    return matched != negated && c != '/';
+}
+
+bool glob_match(std::string_view pattern, std::string_view text) {
+    size_t p = 0;
+    size_t t = 0;
+    // Where to resume after the last single * (backtracking point)
+    size_t star_p = std::string_view::npos;
+    size_t star_t = 0;
+
+    while (t < text.size() || p < pattern.size()) {
+        if (p < pattern.size()) {
+            char c = pattern[p];
+
+            if (c == '*' && p + 1 < pattern.size() && pattern[p + 1] == '*') {
+                // ** must stand alone as a path component to cross directories
+                bool at_start = (p == 0 || pattern[p - 1] == '/');
+                size_t after = p + 2;
+                if (at_start && (after == pattern.size() || pattern[after] == '/')) {
+                    if (after == pattern.size()) return true; // trailing /** matches everything below
+                    // "**/" matches zero or more whole components
+                    std::string_view rest = pattern.substr(after + 1);
+                    for (size_t start = t;; ) {
+                        if (glob_match(rest, text.substr(start))) return true;
+                        size_t slash = text.find('/', start);
+                        if (slash == std::string_view::npos) return false;
+                        start = slash + 1;
+                    }
+                }
+                c = '*'; // otherwise the same as a single *
+                p++;
+            }
+
+            if (c == '*') {
+                star_p = ++p;
+                star_t = t;
+                continue;
+            }
+            if (t < text.size()) {
+                unsigned char tc = static_cast<unsigned char>(text[t]);
+                if (c == '?' && tc != '/') {
+                    p++;
+                    t++;
+                    continue;
+                }
+                if (c == '[') {
+                    size_t end = 0;
+                    bool matched = match_bracket(pattern, p, tc, end);
+                    if (end != std::string_view::npos) {
+                        if (matched) {
+                            p = end;
+                            t++;
+                            continue;
+                        }
+                    } else if (tc == '[') {
+                        p++;
+                        t++;
+                        continue;
+                    }
+                }
+                else if (c == '\\' && p + 1 < pattern.size()) {
+                    if (static_cast<unsigned char>(pattern[p + 1]) == tc) {
+                        p += 2;
+                        t++;
+                        continue;
+                    }
+                }
+                else if (c != '?' && static_cast<unsigned char>(c) == tc) {
+                    p++;
+                    t++;
+                    continue;
+                }
+            }
+        }
+        // Mismatch: let the last * swallow one more byte, but never a '/'
+        if (star_p != std::string_view::npos && star_t < text.size() && text[star_t] != '/') {
+            p = star_p;
+            t = ++star_t;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+void IgnoreRules::add_rules(std::string_view contents) {
+    size_t start = 0;
+    while (start < contents.size()) {
+        size_t newline = contents.find('\n', start);
+        if (newline == std::string_view::npos) newline = contents.size();
+        add_rule(contents.substr(start, newline - start));
+        start = newline + 1;
+    }
+}
+
+void IgnoreRules::add_rule(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    // Trailing spaces are dropped unless quoted with a backslash
+    while (!line.empty() && line.back() == ' ' && !(line.size() >= 2 && line[line.size() - 2] == '\\')) {
+        line.remove_suffix(1);
+    }
+    if (line.empty() || line.front() == '#') {
+        return;
+    }
+
+    Rule rule;
+    if (line.front() == '!') {
+        rule.negated = true;
+        line.remove_prefix(1);
+    } else if (line.front() == '\\' && line.size() > 1 && (line[1] == '!' || line[1] == '#')) {
+        line.remove_prefix(1);
+    }
+    if (!line.empty() && line.back() == '/') {
+        rule.directory_only = true;
+        line.remove_suffix(1);
+    }
+    if (!line.empty() && line.front() == '/') {
+        rule.anchored = true;
+        line.remove_prefix(1);
+    }
+    if (line.find('/') != std::string_view::npos) {
+        rule.anchored = true;
+    }
+    if (line.empty()) {
+        return;
+    }
+    rule.glob = line;
+    rules_.push_back(std::move(rule));
+}
+
+IgnoreMatch IgnoreRules::match(std::string_view relative_path, bool is_directory) const {
+    size_t slash = relative_path.rfind('/');
+    std::string_view name = (slash == std::string_view::npos) ? relative_path : relative_path.substr(slash + 1);
+
+    // Later rules override earlier ones
+    for (auto it = rules_.rbegin(); it != rules_.rend(); ++it) {
+        if (it->directory_only && !is_directory) continue;
+        if (glob_match(it->glob, it->anchored ? relative_path : name)) {
+            return it->negated ? IgnoreMatch::Whitelist : IgnoreMatch::Ignore;
+        }
+    }
+    return IgnoreMatch::None;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Shell-style wildcard match of a whole string. * and ? do not match '/',
+// [...] and [!...] match one byte from a set or range, \ quotes the next byte,
+// and ** matches any number of path components ("**/x", "x/**", "x/**/y").
+bool glob_match(std::string_view pattern, std::string_view text);
+
+// Outcome of testing a path against ignore rules
+enum class IgnoreMatch {
+    None,       // no rule mentions the path
+    Ignore,     // the last matching rule excludes it
+    Whitelist   // the last matching rule is a negated (!) one
+};
+
+// Rules of one .gitignore or .ignore file, in gitignore syntax: one glob per
+// line, # comments, ! to negate, a trailing / for directories only, and a
+// leading or inner / to anchor the glob to the file's directory instead of
+// matching the name at any depth.
+class IgnoreRules {
+public:
+    // Add every rule of a file's contents
+    void add_rules(std::string_view contents);
+
+    // Add one line of gitignore syntax; blank lines and comments add nothing
+    void add_rule(std::string_view line);
+
+    bool empty() const { return rules_.empty(); }
+
+    // Test a path relative to the directory the rules came from
+    IgnoreMatch match(std::string_view relative_path, bool is_directory) const;
+
+private:
+    struct Rule {
+        std::string glob;
+        bool negated = false;
+        bool directory_only = false;
+        bool anchored = false;  // matched against the relative path rather than the name
+    };
+
+    std::vector<Rule> rules_;
+};
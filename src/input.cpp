@@ -0,0 +1,129 @@
+#include "input.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Size of each read(2) when an input has to be copied into memory
+constexpr size_t kReadChunkSize = 1 << 20;
+
+bool InputFile::open(const std::string& path) {
+    if (path == "-") {
+        return open_fd(STDIN_FILENO);
+    }
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool loaded = open_fd(fd);
+    ::close(fd);
+    return loaded;
+}
+
+bool InputFile::open_fd(int fd) {
+    close();
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return false;
+    }
+    if (S_ISDIR(info.st_mode)) {
+        errno = EISDIR;
+        return false;
+    }
+
+    // Map regular files directly; size 0 may be a special file that still has data
+    if (S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+            mapped_ = mapped;
+            mapped_size_ = info.st_size;
+            contents_ = std::string_view(static_cast<const char*>(mapped), mapped_size_);
+            return true;
+        }
+    }
+    return read_all(fd);
+}
+
+bool InputFile::read_all(int fd) {
+    size_t used = 0;
+    for (;;) {
+        if (buffer_.size() - used < kReadChunkSize) {
+            buffer_.resize(used + kReadChunkSize + buffer_.size() / 2);
+        }
+        ssize_t count = ::read(fd, buffer_.data() + used, buffer_.size() - used);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (count == 0) break;
+        used += count;
+    }
+    contents_ = std::string_view(buffer_.data(), used);
+    return true;
+}
+
+void InputFile::close() {
+    if (mapped_) {
+        munmap(mapped_, mapped_size_);
+        mapped_ = nullptr;
+        mapped_size_ = 0;
+    }
+    buffer_.clear();
+    contents_ = {};
+}
+
+StreamReader::StreamReader(int fd, size_t block_size) : fd_(fd), block_size_(block_size) {}
+
+// Append one read(2) to the buffer, first moving the unfinished line to the front
+bool StreamReader::read_block() {
+    if (begin_ > 0) {
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_ -= begin_;
+        line_search_ -= begin_;
+        begin_ = 0;
+    }
+    if (buffer_.size() - end_ < block_size_) {
+        buffer_.resize(end_ + block_size_); // grows only for a line longer than a block
+    }
+    for (;;) {
+        ssize_t count = ::read(fd_, buffer_.data() + end_, block_size_);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            return false;
+        }
+        if (count == 0) eof_ = true;
+        drained_ = static_cast<size_t>(count) < block_size_;
+        end_ += count;
+        return count > 0;
+    }
+}
+
+bool StreamReader::next(std::string_view& lines) {
+    for (;;) {
+        // Earlier bytes were already searched, so a long line is not scanned again per block
+        size_t from = std::max(line_search_, begin_);
+        const void* newline = (end_ > from) ? memrchr(buffer_.data() + from, '\n', end_ - from) : nullptr;
+        line_search_ = end_;
+        if (newline) {
+            size_t end = static_cast<const char*>(newline) - buffer_.data() + 1;
+            lines = std::string_view(buffer_.data() + begin_, end - begin_);
+            begin_ = end;
+            return true;
+        }
+        if (eof_ || failed_) {
+            if (failed_ || begin_ == end_) return false;
+            lines = std::string_view(buffer_.data() + begin_, end_ - begin_); // final line without a newline
+            begin_ = end_;
+            return true;
+        }
+        read_block();
+    }
+}
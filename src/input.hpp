@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Whole contents of one input. Regular files are memory-mapped; pipes, stdin
+// and files that cannot be mapped are read with large read(2) calls instead.
+class InputFile {
+public:
+    InputFile() = default;
+    ~InputFile() { close(); }
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    // Open and load path ("-" means standard input); false if it cannot be read
+    bool open(const std::string& path);
+
+    // Load everything readable from an already open descriptor
+    bool open_fd(int fd);
+
+    void close();
+
+    std::string_view contents() const { return contents_; }
+
+private:
+    bool read_all(int fd);
+
+    void* mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+    std::vector<char> buffer_;  // used when the input is not mapped
+    std::string_view contents_;
+};
+
+// Bytes asked for by each read(2) of a stream
+constexpr size_t kStreamBlockSize = 1 << 20;
+
+// Reads a pipe or other stream in large blocks and hands it out as runs of
+// whole lines. Only the unfinished line at the end of a block is moved to the
+// front of the buffer before the next read, so memory stays at one block plus
+// the longest line however long the stream is.
+class StreamReader {
+public:
+    explicit StreamReader(int fd, size_t block_size = kStreamBlockSize);
+
+    // Next run of lines, each ending in '\n' except the last line of a stream
+    // that lacks one. False at the end of the stream or on a read error.
+    bool next(std::string_view& lines);
+
+    // True once a read has failed; errno holds the reason
+    bool failed() const { return failed_; }
+
+    // True if the last read came back short, so the next one may block
+    bool drained() const { return drained_; }
+
+private:
+    bool read_block();
+
+    int fd_;
+    size_t block_size_;
+    std::vector<char> buffer_;
+    size_t begin_ = 0;         // start of the bytes not yet handed out
+    size_t end_ = 0;           // end of the bytes read
+    size_t line_search_ = 0;   // bytes before this offset hold no newline past begin_
+    bool eof_ = false;
+    bool failed_ = false;
+    bool drained_ = false;
+};
@@ -0,0 +1,218 @@
+#include "lazy_dfa.hpp"
+
+#include <algorithm>
+
+#include "stats.hpp"
+
+// Flushes tolerated per search before the hit rate is checked
+constexpr size_t kMinFlushesBeforeGiveUp = 2;
+
+// Fewer bytes scanned per cached state than this means the cache is thrashing
+constexpr size_t kMinBytesPerState = 10;
+
+size_t LazyDFA::PcsHash::operator()(const std::vector<int>& pcs) const {
+    size_t hash = pcs.size();
+    for (int pc : pcs) {
+        hash ^= static_cast<size_t>(pc) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+void LazyDFA::reset(const Program& program, bool anchored_start) {
+    program_ = &program;
+    program_id_ = program.id;
+    anchored_start_ = anchored_start;
+    marks_.assign(program.code.size(), 0);
+    mark_epoch_ = 0;
+    clear_cache();
+    flush_count_ = 0;
+}
+
+// Drop every cached state, keeping only the dead state at id 0
+void LazyDFA::clear_cache() {
+    flush_count_++;
+    states_before_flush_ = states_.size();
+
+    states_.clear();
+    state_ids_.clear();
+    transitions_.assign(program_->byte_class_count, kDead);
+    states_.emplace_back();
+    cache_bytes_ = transitions_.size() * sizeof(int);
+    start_state_ = kUnknown;
+}
+
+// Return the id for a set of NFA instructions, creating the state if needed
+int LazyDFA::intern_state(std::vector<int>& pcs) {
+    if (pcs.empty()) {
+        return kDead;
+    }
+    std::sort(pcs.begin(), pcs.end());
+
+    auto found = state_ids_.find(pcs);
+    if (found != state_ids_.end()) {
+        return found->second;
+    }
+
+    // Key copy + state copy + one transition row + bookkeeping
+    size_t cost = 2 * pcs.size() * sizeof(int) + program_->byte_class_count * sizeof(int) + 64;
+    if (cache_bytes_ + cost > cache_budget_) {
+        clear_cache();
+    }
+    cache_bytes_ += cost;
+    record_peak(Stat::PeakDfaCache, cache_bytes_);
+
+    int id = static_cast<int>(states_.size());
+    State state;
+    state.pcs = pcs;
+    for (int pc : pcs) {
+        if (program_->code[pc].op == Opcode::Match) state.match = true;
+    }
+    states_.push_back(std::move(state));
+    transitions_.resize(transitions_.size() + program_->byte_class_count, kUnknown);
+    state_ids_.emplace(pcs, id);
+    return id;
+}
+
+// Append the instructions reachable from pc through empty transitions.
+// Positions already marked in the current epoch are skipped.
+void LazyDFA::add_closure(int pc, bool at_start, bool at_end, std::vector<int>& out) {
+    stack_.clear();
+    stack_.push_back(pc);
+
+    while (!stack_.empty()) {
+        int current = stack_.back();
+        stack_.pop_back();
+        if (marks_[current] == mark_epoch_) {
+            continue;
+        }
+        marks_[current] = mark_epoch_;
+
+        const Instruction& inst = program_->code[current];
+        switch (inst.op) {
+            case Opcode::Jump:
+                stack_.push_back(inst.x);
+                break;
+            case Opcode::Split:
+                stack_.push_back(inst.y);
+                stack_.push_back(inst.x);
+                break;
+            case Opcode::Save:
+            case Opcode::RepeatStart:
+            case Opcode::RepeatCheck:
+                stack_.push_back(current + 1);
+                break;
+            case Opcode::AssertStart:
+                if (at_start) stack_.push_back(current + 1);
+                break;
+            case Opcode::AssertEnd:
+                if (at_end) stack_.push_back(current + 1);
+                else out.push_back(current); // resolved once the input ends
+                break;
+            case Opcode::Backref:
+                break; // never compiled into a DFA
+            default:
+                out.push_back(current);
+                break;
+        }
+    }
+}
+
+int LazyDFA::compute_transition(int state, unsigned char byte) {
+    next_pcs_.clear();
+    mark_epoch_++;
+
+    for (int pc : states_[state].pcs) {
+        const Instruction& inst = program_->code[pc];
+        bool consumes = false;
+        switch (inst.op) {
+            case Opcode::Byte:  consumes = (byte == inst.byte); break;
+            case Opcode::Any:   consumes = true; break;
+            case Opcode::Class: consumes = program_->classes[inst.x].test(byte); break;
+            default: break;
+        }
+        if (consumes) {
+            add_closure(pc + 1, false, false, next_pcs_);
+        }
+    }
+
+    // Unanchored search restarts the pattern at every offset
+    if (!anchored_start_) {
+        add_closure(0, false, false, next_pcs_);
+    }
+
+    size_t flushes = flush_count_;
+    int next = intern_state(next_pcs_);
+    if (flush_count_ == flushes) {
+        transitions_[state * program_->byte_class_count + program_->byte_classes[byte]] = next;
+    }
+    return next;
+}
+
+// Resolve pending $ assertions once the input is exhausted
+bool LazyDFA::matches_at_end(int state, bool at_start) {
+    if (states_[state].match) {
+        return true;
+    }
+    next_pcs_.clear();
+    mark_epoch_++;
+    for (int pc : states_[state].pcs) {
+        if (program_->code[pc].op == Opcode::AssertEnd) {
+            add_closure(pc, at_start, true, next_pcs_);
+        }
+    }
+    for (int pc : next_pcs_) {
+        if (program_->code[pc].op == Opcode::Match) return true;
+    }
+    return false;
+}
+
+DfaResult LazyDFA::search(const Program& program, std::string_view input, bool anchored_start) {
+    if (program_id_ != program.id || anchored_start_ != anchored_start) {
+        reset(program, anchored_start);
+    }
+    program_ = &program;
+
+    if (start_state_ == kUnknown) {
+        next_pcs_.clear();
+        mark_epoch_++;
+        add_closure(0, true, false, next_pcs_);
+        start_state_ = intern_state(next_pcs_);
+    }
+
+    int state = start_state_;
+    if (states_[state].match) {
+        return DfaResult::Match;
+    }
+
+    const int class_count = program.byte_class_count;
+    size_t search_flushes = flush_count_;
+    size_t last_flush_pos = 0;
+
+    for (size_t i = 0; i < input.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(input[i]);
+        int next = transitions_[state * class_count + program.byte_classes[c]];
+
+        if (next == kUnknown) {
+            size_t flushes = flush_count_;
+            next = compute_transition(state, c);
+
+            // Give up when the cache is rebuilt too often to pay for itself
+            if (flush_count_ != flushes) {
+                if (flush_count_ - search_flushes >= kMinFlushesBeforeGiveUp &&
+                    i - last_flush_pos < kMinBytesPerState * states_before_flush_) {
+                    return DfaResult::GaveUp;
+                }
+                last_flush_pos = i;
+            }
+        }
+
+        state = next;
+        if (state == kDead) {
+            return DfaResult::NoMatch;
+        }
+        if (states_[state].match) {
+            return DfaResult::Match;
+        }
+    }
+    return matches_at_end(state, input.empty()) ? DfaResult::Match : DfaResult::NoMatch;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "program.hpp"
+
+// Outcome of a DFA search; GaveUp means the caller should use the NFA instead
+enum class DfaResult { Match, NoMatch, GaveUp };
+
+// Match-only DFA whose states are built on demand from a Program's NFA.
+// Transitions are cached in a table indexed by byte class, so the inner loop
+// is one lookup per input byte. The cache is flushed when it outgrows its
+// memory budget, and the search gives up if flushing happens too often.
+class LazyDFA {
+public:
+    static constexpr size_t kDefaultCacheBudget = 2 << 20;
+
+    explicit LazyDFA(size_t cache_budget = kDefaultCacheBudget) : cache_budget_(cache_budget) {}
+
+    // Report whether the program matches anywhere in input (or at its start when anchored)
+    DfaResult search(const Program& program, std::string_view input, bool anchored_start);
+
+private:
+    static constexpr int kUnknown = -1;
+    static constexpr int kDead = 0;
+
+    struct State {
+        std::vector<int> pcs;  // NFA instructions this state stands for, sorted
+        bool match = false;
+    };
+
+    struct PcsHash {
+        size_t operator()(const std::vector<int>& pcs) const;
+    };
+
+    void reset(const Program& program, bool anchored_start);
+    void clear_cache();
+    int intern_state(std::vector<int>& pcs);
+    void add_closure(int pc, bool at_start, bool at_end, std::vector<int>& out);
+    int compute_transition(int state, unsigned char byte);
+    bool matches_at_end(int state, bool at_start);
+
+    const Program* program_ = nullptr;
+    uint64_t program_id_ = 0;
+    bool anchored_start_ = false;
+    size_t cache_budget_;
+    size_t cache_bytes_ = 0;
+    size_t flush_count_ = 0;
+    size_t states_before_flush_ = 0;
+
+    std::vector<State> states_;
+    std::vector<int> transitions_;  // states_.size() x byte_class_count
+    std::unordered_map<std::vector<int>, int, PcsHash> state_ids_;
+    int start_state_ = kUnknown;
+
+    // Scratch reused by closure computation
+    std::vector<int> marks_;
+    int mark_epoch_ = 0;
+    std::vector<int> stack_;
+    std::vector<int> next_pcs_;
+};
@@ -0,0 +1,133 @@
+#include "literal_finder.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define GREP_HAVE_SSE2 1
+#endif
+
+#if defined(GREP_HAVE_SSE2) && defined(__GNUC__)
+#define GREP_HAVE_AVX2_DISPATCH 1
+#endif
+
+int byte_frequency_rank(unsigned char c) {
+    // Lowercase letters ordered from most to least common in English text
+    static const char* letters = "etaoinshrdlcumwfgypbvkjxqz";
+
+    if (c == ' ') return 255;
+    if (c >= 'a' && c <= 'z') return 250 - static_cast<int>(std::strchr(letters, c) - letters) * 4;
+    if (c >= '0' && c <= '9') return 150;
+    if (c >= 'A' && c <= 'Z') return 110;
+    if (c != '\0' && std::strchr(".,:;/-_=\"'()[]", c)) return 120;
+    if (c == '\t' || c == '\n') return 100;
+    if (c < 0x20 || c >= 0x7f) return 10;
+    return 60; // remaining punctuation
+}
+
+LiteralFinder::LiteralFinder(std::string needle) : needle_(std::move(needle)) {
+    // Pick the two rarest bytes so SIMD candidates are few
+    for (size_t i = 1; i < needle_.size(); i++) {
+        if (byte_frequency_rank(needle_[i]) < byte_frequency_rank(needle_[rare1_])) rare1_ = i;
+    }
+    rare2_ = (rare1_ == 0 && needle_.size() > 1) ? 1 : 0;
+    for (size_t i = 0; i < needle_.size(); i++) {
+        if (i == rare1_) continue;
+        bool rarer = byte_frequency_rank(needle_[i]) < byte_frequency_rank(needle_[rare2_]);
+        bool repeats_rare1 = needle_[i] == needle_[rare1_] && needle_[rare2_] != needle_[rare1_];
+        if (rarer && !repeats_rare1) rare2_ = i;
+    }
+}
+
+size_t LiteralFinder::find_scalar(std::string_view haystack, size_t from) const {
+    return haystack.find(needle_, from);
+}
+
+#ifdef GREP_HAVE_SSE2
+size_t LiteralFinder::find_sse2(std::string_view haystack, size_t from) const {
+    const char* data = haystack.data();
+    const size_t length = haystack.size();
+    const size_t needle_length = needle_.size();
+    const size_t max_offset = rare1_ > rare2_ ? rare1_ : rare2_;
+
+    const __m128i first = _mm_set1_epi8(needle_[rare1_]);
+    const __m128i second = _mm_set1_epi8(needle_[rare2_]);
+
+    size_t i = from;
+    while (i + max_offset + 16 <= length) {
+        __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + rare1_));
+        __m128i block2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + rare2_));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block1, first), _mm_cmpeq_epi8(block2, second))));
+
+        while (mask != 0) {
+            size_t start = i + __builtin_ctz(mask);
+            if (start + needle_length <= length && std::memcmp(data + start, needle_.data(), needle_length) == 0) {
+                return start;
+            }
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+    return find_scalar(haystack, i);
+}
+#else
+size_t LiteralFinder::find_sse2(std::string_view haystack, size_t from) const {
+    return find_scalar(haystack, from);
+}
+#endif
+
+#ifdef GREP_HAVE_AVX2_DISPATCH
+__attribute__((target("avx2")))
+size_t LiteralFinder::find_avx2(std::string_view haystack, size_t from) const {
+    const char* data = haystack.data();
+    const size_t length = haystack.size();
+    const size_t needle_length = needle_.size();
+    const size_t max_offset = rare1_ > rare2_ ? rare1_ : rare2_;
+
+    const __m256i first = _mm256_set1_epi8(needle_[rare1_]);
+    const __m256i second = _mm256_set1_epi8(needle_[rare2_]);
+
+    size_t i = from;
+    while (i + max_offset + 32 <= length) {
+        __m256i block1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + rare1_));
+        __m256i block2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + rare2_));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block1, first), _mm256_cmpeq_epi8(block2, second))));
+
+        while (mask != 0) {
+            size_t start = i + __builtin_ctz(mask);
+            if (start + needle_length <= length && std::memcmp(data + start, needle_.data(), needle_length) == 0) {
+                return start;
+            }
+            mask &= mask - 1;
+        }
+        i += 32;
+    }
+    return find_sse2(haystack, i);
+}
+#else
+size_t LiteralFinder::find_avx2(std::string_view haystack, size_t from) const {
+    return find_sse2(haystack, from);
+}
+#endif
+
+size_t LiteralFinder::find(std::string_view haystack, size_t from) const {
+    if (from > haystack.size()) {
+        return std::string_view::npos;
+    }
+    if (needle_.size() <= 1) {
+        if (needle_.empty()) return from;
+        if (from == haystack.size()) return std::string_view::npos;
+        const void* hit = std::memchr(haystack.data() + from, needle_[0], haystack.size() - from);
+        return hit ? static_cast<const char*>(hit) - haystack.data() : std::string_view::npos;
+    }
+
+#ifdef GREP_HAVE_AVX2_DISPATCH
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        return find_avx2(haystack, from);
+    }
+#endif
+    return find_sse2(haystack, from);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Substring search tuned for a fixed needle. Candidate positions come from
+// comparing the needle's two rarest bytes against 16/32 haystack bytes at a
+// time (SSE2, or AVX2 when the CPU has it); each candidate is then verified.
+class LiteralFinder {
+public:
+    explicit LiteralFinder(std::string needle);
+
+    // Offset of the first occurrence at or after `from`, or npos
+    size_t find(std::string_view haystack, size_t from = 0) const;
+
+    const std::string& needle() const { return needle_; }
+
+private:
+    size_t find_scalar(std::string_view haystack, size_t from) const;
+    size_t find_sse2(std::string_view haystack, size_t from) const;
+    size_t find_avx2(std::string_view haystack, size_t from) const;
+
+    std::string needle_;
+    size_t rare1_ = 0;  // offset of the rarest needle byte
+    size_t rare2_ = 0;  // offset of the second rarest, distinct from rare1_ when possible
+};
+
+// Approximate frequency of a byte in typical text and logs; higher is more common
+int byte_frequency_rank(unsigned char c);
@@ -0,0 +1,111 @@
+#include "matcher.hpp"
+
+#include "stats.hpp"
+
+size_t MatchScratch::take_skipped_lines() {
+    size_t skipped = skipped_lines_;
+    skipped_lines_ = 0;
+    return skipped;
+}
+
+bool match_string(std::string_view input_line, const CompiledPattern& compiled, MatchScratch& scratch) {
+    // Lines missing every required literal cannot match
+    if (!compiled.prefilter.may_match(input_line)) {
+        return false;
+    }
+    return match_candidate(input_line, compiled, scratch);
+}
+
+bool match_candidate(std::string_view input_line, const CompiledPattern& compiled, MatchScratch& scratch) {
+    count_stat(Stat::MatchCalls);
+
+    // Plain strings are settled by the literal automata alone
+    if (compiled.literal_only) {
+        count_stat(Stat::LiteralSetSearches);
+        return compiled.prefilter.find(input_line) != std::string_view::npos;
+    }
+    if (!compiled.literal_set.empty()) {
+        count_stat(Stat::LiteralSetSearches);
+        if (compiled.literal_set.contains(input_line)) {
+            return true;
+        }
+    }
+
+    // Backreferences are not regular and need the backtracker
+    if (compiled.has_backrefs) {
+        count_stat(Stat::BacktrackSearches);
+        BacktrackResult result = scratch.backtracker_.search(compiled.program, input_line, compiled.anchored_start,
+                                                             compiled.backtrack_limit);
+        if (result == BacktrackResult::StepLimit) {
+            scratch.skipped_lines_++;
+        }
+        return result == BacktrackResult::Match;
+    }
+
+    // Otherwise try the DFA, then the linear-time VM
+    count_stat(Stat::DfaSearches);
+    DfaResult result = scratch.lazy_dfa_.search(compiled.program, input_line, compiled.anchored_start);
+    if (result != DfaResult::GaveUp) {
+        return result == DfaResult::Match;
+    }
+    count_stat(Stat::DfaGaveUp);
+    count_stat(Stat::PikeSearches);
+    return scratch.pike_vm_.search(compiled.program, input_line, compiled.anchored_start);
+}
+
+size_t match_lines(std::span<const std::string_view> lines, const CompiledPattern& compiled, MatchScratch& scratch,
+                   MatchBitmap& matches) {
+    matches.reset(lines.size());
+    size_t count = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (match_string(lines[i], compiled, scratch)) {
+            matches.set(i);
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t match_buffer_lines(std::string_view buffer, std::span<const size_t> line_offsets,
+                          const CompiledPattern& compiled, MatchScratch& scratch, MatchBitmap& matches) {
+    size_t line_count = line_offsets.empty() ? 0 : line_offsets.size() - 1;
+    matches.reset(line_count);
+    size_t count = 0;
+
+    for (size_t i = 0; i < line_count; i++) {
+        // Jump straight to the line holding the next prefilter hit
+        if (!compiled.prefilter.empty()) {
+            size_t hit = compiled.prefilter.find(buffer.substr(0, line_offsets[line_count]), line_offsets[i]);
+            if (hit == std::string_view::npos) {
+                break;
+            }
+            while (line_offsets[i + 1] <= hit) i++;
+        }
+
+        size_t start = line_offsets[i];
+        size_t end = line_offsets[i + 1];
+        if (end > start && buffer[end - 1] == '\n') end--;
+        if (match_candidate(buffer.substr(start, end - start), compiled, scratch)) {
+            matches.set(i);
+            count++;
+        }
+    }
+    return count;
+}
+
+MatchScratch& thread_scratch() {
+    thread_local MatchScratch scratch;
+    return scratch;
+}
+
+bool match_string(std::string_view input_line, const CompiledPattern& compiled) {
+    return match_string(input_line, compiled, thread_scratch());
+}
+
+bool match_candidate(std::string_view input_line, const CompiledPattern& compiled) {
+    return match_candidate(input_line, compiled, thread_scratch());
+}
+
+size_t take_skipped_lines() {
+    return thread_scratch().take_skipped_lines();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "backtracker.hpp"
+#include "lazy_dfa.hpp"
+#include "pattern.hpp"
+#include "pike_vm.hpp"
+
+// Mutable state for matching on one thread: engine buffers and the DFA state
+// cache, which persists for as long as the same pattern is matched. A scratch
+// must not be used by two threads at once; CompiledPattern can be.
+class MatchScratch {
+public:
+    // Number of lines skipped at the backtracking step limit since the last call.
+    // Skipped lines are reported as not matching.
+    size_t take_skipped_lines();
+
+private:
+    friend bool match_candidate(std::string_view, const CompiledPattern&, MatchScratch&);
+
+    LazyDFA lazy_dfa_;
+    PikeVM pike_vm_;
+    Backtracker backtracker_;
+    size_t skipped_lines_ = 0;
+};
+
+// One bit per input line, set when the line matched
+struct MatchBitmap {
+    std::vector<uint64_t> words;
+    size_t size = 0;
+
+    void reset(size_t lines) {
+        size = lines;
+        words.assign((lines + 63) / 64, 0);
+    }
+    void set(size_t line) { words[line / 64] |= uint64_t{1} << (line % 64); }
+    bool test(size_t line) const { return (words[line / 64] >> (line % 64)) & 1; }
+};
+
+// Match complete line against a compiled pattern (unanchored unless the pattern starts with ^)
+bool match_string(std::string_view input_line, const CompiledPattern& compiled, MatchScratch& scratch);
+
+// Same as match_string for a line the caller has already passed through the prefilter
+bool match_candidate(std::string_view input_line, const CompiledPattern& compiled, MatchScratch& scratch);
+
+// Test every line, setting bit i of matches when lines[i] matches. Returns the number of matches.
+size_t match_lines(std::span<const std::string_view> lines, const CompiledPattern& compiled, MatchScratch& scratch,
+                   MatchBitmap& matches);
+
+// Batch form for one buffer: line i is buffer[line_offsets[i], line_offsets[i + 1]) without
+// a trailing '\n', so line_offsets holds one entry more than there are lines. The prefilter
+// runs over the whole buffer, skipping lines without a literal hit. Returns the number of matches.
+size_t match_buffer_lines(std::string_view buffer, std::span<const size_t> line_offsets,
+                          const CompiledPattern& compiled, MatchScratch& scratch, MatchBitmap& matches);
+
+// Scratch owned by the calling thread, for callers that do not manage their own
+MatchScratch& thread_scratch();
+
+// Shorthands using thread_scratch()
+bool match_string(std::string_view input_line, const CompiledPattern& compiled);
+bool match_candidate(std::string_view input_line, const CompiledPattern& compiled);
+size_t take_skipped_lines();
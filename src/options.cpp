@@ -0,0 +1,226 @@
+#include "options.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// Parse a strictly positive integer option value
+bool parse_count(const char* text, int& value) {
+    char* end = nullptr;
+    long parsed = std::strtol(text, &end, 10);
+    if (end == text || *end != '\0' || parsed <= 0 || parsed > 1 << 20) {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+// Parse a non-negative size option value
+bool parse_size(const char* text, size_t& value) {
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (end == text || *end != '\0' || *text == '-' || errno == ERANGE) {
+        return false;
+    }
+    value = static_cast<size_t>(parsed);
+    return true;
+}
+
+// Add each line of text as a separate pattern, as grep does for -e and -f
+void add_patterns(std::string_view text, std::vector<std::string>& patterns) {
+    size_t start = 0;
+    for (;;) {
+        size_t newline = text.find('\n', start);
+        if (newline == std::string_view::npos) {
+            patterns.emplace_back(text.substr(start));
+            return;
+        }
+        patterns.emplace_back(text.substr(start, newline - start));
+        start = newline + 1;
+    }
+}
+
+// Read patterns from a file, one per line; an empty file adds none
+bool read_pattern_file(const std::string& path, std::vector<std::string>& patterns) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string text = contents.str();
+    if (text.empty()) {
+        return true;
+    }
+    if (text.back() == '\n') text.pop_back();
+    add_patterns(text, patterns);
+    return true;
+}
+
+bool parse_options(int argc, char* argv[], Options& options, std::string& error) {
+    bool have_pattern = false;
+    int i = 1;
+
+    for (; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--") {
+            i++;
+            break;
+        }
+        if (arg.size() < 2 || arg[0] != '-') {
+            break; // first operand
+        }
+
+        if (arg == "-r") {
+            options.recursive = true;
+        }
+        else if (arg == "-q") {
+            options.quiet = true;
+        }
+        else if (arg == "-l") {
+            options.files_with_matches = true;
+        }
+        else if (arg == "-c") {
+            options.count = true;
+        }
+        else if (arg == "-z") {
+            options.scan.decompress = true;
+        }
+        else if (arg.rfind("-m", 0) == 0) {
+            const char* value = arg.size() > 2 ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            if (!parse_size(value, options.max_count)) {
+                error = "Invalid max count '" + std::string(value) + "'";
+                return false;
+            }
+        }
+        else if (arg == "-E") {
+            // The pattern follows -E
+            if (i + 1 >= argc) {
+                error = "Option -E requires a pattern";
+                return false;
+            }
+            options.extended = true;
+            add_patterns(argv[++i], options.patterns);
+            have_pattern = true;
+        }
+        else if (arg == "-e" || arg == "-f") {
+            if (i + 1 >= argc) {
+                error = "Option " + arg + " requires " + (arg == "-e" ? "a pattern" : "a file");
+                return false;
+            }
+            const char* value = argv[++i];
+            if (arg == "-e") {
+                add_patterns(value, options.patterns);
+            }
+            else if (!read_pattern_file(value, options.patterns)) {
+                error = "Could not read pattern file '" + std::string(value) + "'";
+                return false;
+            }
+            have_pattern = true;
+        }
+        else if (arg.rfind("-j", 0) == 0) {
+            const char* value = arg.size() > 2 ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+            if (!parse_count(value, options.jobs)) {
+                error = "Invalid number of jobs '" + std::string(value) + "'";
+                return false;
+            }
+        }
+        else if (arg == "--line-buffered") {
+            options.line_buffered = true;
+        }
+        else if (arg.rfind("--max-inflight=", 0) == 0) {
+            const char* value = argv[i] + std::strlen("--max-inflight=");
+            if (!parse_count(value, options.max_inflight)) {
+                error = "Invalid in-flight file limit '" + std::string(value) + "'";
+                return false;
+            }
+        }
+        else if (arg == "--stats" || arg == "--stats=json") {
+            options.stats = true;
+            options.stats_json = (arg == "--stats=json");
+        }
+        else if (arg.rfind("--backtrack-limit=", 0) == 0) {
+            const char* value = argv[i] + std::strlen("--backtrack-limit=");
+            if (!parse_size(value, options.backtrack_limit)) {
+                error = "Invalid backtracking limit '" + std::string(value) + "'";
+                return false;
+            }
+        }
+        else if (arg == "-I") {
+            options.binary_files = BinaryFiles::Skip;
+        }
+        else if (arg.rfind("--binary-files=", 0) == 0) {
+            std::string value = arg.substr(std::strlen("--binary-files="));
+            if (value == "binary") options.binary_files = BinaryFiles::Summary;
+            else if (value == "without-match") options.binary_files = BinaryFiles::Skip;
+            else if (value == "text") options.binary_files = BinaryFiles::Text;
+            else {
+                error = "Invalid binary file type '" + value + "', expected binary, without-match or text";
+                return false;
+            }
+        }
+        else if (arg.rfind("--include=", 0) == 0) {
+            options.walk.include_globs.push_back(arg.substr(std::strlen("--include=")));
+        }
+        else if (arg.rfind("--exclude=", 0) == 0) {
+            options.walk.exclude_globs.push_back(arg.substr(std::strlen("--exclude=")));
+        }
+        else if (arg.rfind("--exclude-dir=", 0) == 0) {
+            options.walk.exclude_dir_globs.push_back(arg.substr(std::strlen("--exclude-dir=")));
+        }
+        else if (arg.rfind("--prefetch=", 0) == 0) {
+            std::string value = arg.substr(std::strlen("--prefetch="));
+            if (value == "auto") options.scan.prefetch = PrefetchMode::Auto;
+            else if (value == "thread") options.scan.prefetch = PrefetchMode::Thread;
+            else if (value == "io_uring") options.scan.prefetch = PrefetchMode::IoUring;
+            else if (value == "off") options.scan.prefetch = PrefetchMode::Off;
+            else {
+                error = "Invalid prefetch mode '" + value + "', expected auto, thread, io_uring or off";
+                return false;
+            }
+        }
+        else if (arg == "--no-ignore") {
+            options.walk.use_ignore_files = false;
+        }
+        else if (arg == "--index" || arg.rfind("--index=", 0) == 0) {
+            std::string value = (arg == "--index") ? (i + 1 < argc ? argv[++i] : "") : arg.substr(std::strlen("--index="));
+            if (value == "build") options.index_mode = IndexMode::Build;
+            else if (value == "update") options.index_mode = IndexMode::Update;
+            else if (value == "use") options.index_mode = IndexMode::Use;
+            else {
+                error = "Invalid index mode '" + value + "', expected build, update or use";
+                return false;
+            }
+        }
+        else if (arg.rfind("--index-file=", 0) == 0) {
+            options.index_file = arg.substr(std::strlen("--index-file="));
+            if (options.index_file.empty()) {
+                error = "Option --index-file requires a path";
+                return false;
+            }
+        }
+        else {
+            error = "Unknown option '" + arg + "'";
+            return false;
+        }
+    }
+
+    // Building an index searches nothing, so it needs no pattern
+    bool indexing = options.index_mode == IndexMode::Build || options.index_mode == IndexMode::Update;
+    if (!have_pattern && !indexing) {
+        error = "Expected a pattern from -E, -e or -f";
+        return false;
+    }
+    if (options.index_mode == IndexMode::Use && !options.recursive) {
+        error = "Option --index use requires -r";
+        return false;
+    }
+
+    for (; i < argc; i++) {
+        options.paths.push_back(argv[i]);
+    }
+    return true;
+}
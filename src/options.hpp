@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "directory_walker.hpp"
+#include "file_scanner.hpp"
+#include "pattern.hpp"
+#include "trigram_index.hpp"
+
+// What to do with the trigram index (--index)
+enum class IndexMode {
+    None,    // search without an index
+    Build,   // index the given roots from scratch, then exit
+    Update,  // re-read only files changed since the last build or update, then exit
+    Use      // skip files the index rules out during -r
+};
+
+// Command line settings
+struct Options {
+    bool recursive = false;          // -r
+    bool extended = false;           // -E
+    std::vector<std::string> patterns;  // -E, -e and -f; a line matches if any pattern does
+    std::vector<std::string> paths;  // files, or directories with -r
+    bool quiet = false;              // -q, print nothing and stop at the first match
+    bool files_with_matches = false; // -l, print the name of each file with a match
+    bool count = false;              // -c, print the number of matching lines per file
+    size_t max_count = kNoMaxCount;  // -m N, stop reading a file after N matching lines
+    BinaryFiles binary_files = BinaryFiles::Summary;  // --binary-files=binary|without-match|text, -I
+    WalkOptions walk;                // --include, --exclude, --exclude-dir, --no-ignore
+    ScanOptions scan;                // --prefetch=auto|thread|io_uring|off, -z
+    int jobs = 0;                    // -j N; 0 picks the number of cores
+    bool line_buffered = false;      // --line-buffered, flush output after every line
+    int max_inflight = 1024;         // --max-inflight=N, files or chunks scanned ahead of output
+    size_t backtrack_limit = kDefaultBacktrackLimit;  // --backtrack-limit=N, 0 for no limit
+    bool stats = false;              // --stats, report counters and timings to stderr
+    bool stats_json = false;         // --stats=json, the same as a JSON object
+    IndexMode index_mode = IndexMode::None;    // --index build|update|use
+    std::string index_file = kDefaultIndexFile;  // --index-file=PATH
+};
+
+// Parse argv into options; returns false and sets error on invalid usage
+bool parse_options(int argc, char* argv[], Options& options, std::string& error);
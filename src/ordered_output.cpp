@@ -0,0 +1,51 @@
+#include "ordered_output.hpp"
+
+#include "stats.hpp"
+
+size_t OrderedOutput::begin_file() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    window_open_.wait(lock, [this] { return next_file_ - head_ < window_; });
+    return next_file_++;
+}
+
+// A line-buffered writer flushes each block it is given, so the head unit's
+// records reach the output as soon as they are written here
+void OrderedOutput::emit(std::string& data) {
+    writer_.write_block(data);
+}
+
+void OrderedOutput::write(size_t file, std::string& chunk) {
+    StatTimer timer(Stat::OutputNanos);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file == head_) {
+        emit(chunk); // every earlier file is done, stream directly
+    } else {
+        pending_[file].data += chunk;
+        pending_bytes_ += chunk.size();
+        record_peak(Stat::PeakPendingOutput, pending_bytes_);
+    }
+    chunk.clear();
+}
+
+void OrderedOutput::finish(size_t file) {
+    StatTimer timer(Stat::OutputNanos);
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_[file].finished = true;
+
+    // Release the head and every finished file directly behind it
+    while (true) {
+        auto block = pending_.find(head_);
+        if (block == pending_.end()) {
+            break;
+        }
+        pending_bytes_ -= block->second.data.size();
+        emit(block->second.data);
+        if (!block->second.finished) {
+            block->second.data.clear(); // new head keeps streaming through write()
+            break;
+        }
+        pending_.erase(block);
+        head_++;
+    }
+    window_open_.notify_all();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "output_writer.hpp"
+
+// Writes per-file output blocks in file order while files finish out of
+// order. Files are numbered by begin_file(); output of the lowest unfinished
+// file goes straight through, later files are held until it completes. At
+// most `window` files may be in flight, which bounds the memory held back.
+class OrderedOutput {
+public:
+    OrderedOutput(OutputWriter& writer, size_t window) : writer_(writer), window_(window > 0 ? window : 1) {}
+
+    // Number the next file, waiting while the in-flight window is full
+    size_t begin_file();
+
+    // Hand over output produced so far for a file; chunk is left empty but may
+    // come back as a recycled buffer
+    void write(size_t file, std::string& chunk);
+
+    // Mark a file complete so later files can be released
+    void finish(size_t file);
+
+private:
+    struct Block {
+        std::string data;
+        bool finished = false;
+    };
+
+    void emit(std::string& data);
+
+    OutputWriter& writer_;  // guarded by mutex_
+    size_t window_;
+    std::mutex mutex_;
+    std::condition_variable window_open_;
+    size_t next_file_ = 0;   // number given to the next begin_file()
+    size_t head_ = 0;        // lowest file not yet finished
+    std::map<size_t, Block> pending_;
+    size_t pending_bytes_ = 0;  // total size of pending_ data
+};
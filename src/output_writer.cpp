@@ -0,0 +1,107 @@
+#include "output_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Emptied buffers kept around for reuse
+constexpr size_t kMaxSpareBuffers = 16;
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+OutputWriter::OutputWriter(int fd, size_t flush_threshold) : fd_(fd), flush_threshold_(flush_threshold) {
+    fill_.reserve(flush_threshold_);
+}
+
+std::string OutputWriter::take_spare() {
+    if (spares_.empty()) {
+        return std::string();
+    }
+    std::string spare = std::move(spares_.back());
+    spares_.pop_back();
+    return spare;
+}
+
+// Move the partially filled buffer into the queue so ordering with blocks is kept
+void OutputWriter::seal_fill_buffer() {
+    if (fill_.empty()) {
+        return;
+    }
+    queued_bytes_ += fill_.size();
+    queued_.push_back(std::move(fill_));
+    fill_ = take_spare();
+}
+
+void OutputWriter::maybe_flush() {
+    if (line_buffered_ || queued_bytes_ + fill_.size() >= flush_threshold_) {
+        flush();
+    }
+}
+
+void OutputWriter::write_line(std::string_view prefix, std::string_view line) {
+    fill_.append(prefix);
+    fill_.append(line);
+    fill_.push_back('\n');
+    maybe_flush();
+}
+
+void OutputWriter::write_block(std::string& block) {
+    if (block.empty()) {
+        return;
+    }
+    seal_fill_buffer();
+    queued_bytes_ += block.size();
+    queued_.push_back(std::move(block));
+    block = take_spare();
+    maybe_flush();
+}
+
+void OutputWriter::flush() {
+    seal_fill_buffer();
+
+    // Gather every queued buffer into as few writev calls as possible
+    std::vector<iovec> iov;
+    iov.reserve(std::min<size_t>(queued_.size(), IOV_MAX));
+    size_t next = 0;
+    while (next < queued_.size() && !failed_) {
+        iov.clear();
+        for (size_t i = next; i < queued_.size() && iov.size() < IOV_MAX; i++) {
+            iov.push_back({queued_[i].data(), queued_[i].size()});
+        }
+        next += iov.size();
+
+        // Retry until the batch is fully written, advancing past partial writes
+        iovec* pending = iov.data();
+        int count = static_cast<int>(iov.size());
+        while (count > 0) {
+            ssize_t written = writev(fd_, pending, count);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                failed_ = true;
+                break;
+            }
+            while (count > 0 && static_cast<size_t>(written) >= pending->iov_len) {
+                written -= pending->iov_len;
+                pending++;
+                count--;
+            }
+            if (count > 0) {
+                pending->iov_base = static_cast<char*>(pending->iov_base) + written;
+                pending->iov_len -= written;
+            }
+        }
+    }
+
+    for (std::string& buffer : queued_) {
+        if (spares_.size() < kMaxSpareBuffers) {
+            buffer.clear();
+            spares_.push_back(std::move(buffer));
+        }
+    }
+    queued_.clear();
+    queued_bytes_ = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Batches output records into large reusable buffers and writes them with
+// writev(2) once enough has accumulated, instead of a write per line.
+// Not thread-safe: give each thread its own writer or serialize access.
+class OutputWriter {
+public:
+    static constexpr size_t kDefaultFlushThreshold = 256 << 10;
+
+    explicit OutputWriter(int fd, size_t flush_threshold = kDefaultFlushThreshold);
+    ~OutputWriter() { flush(); }
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Flush after every record, for interactive use (--line-buffered)
+    void set_line_buffered(bool enabled) { line_buffered_ = enabled; }
+    bool line_buffered() const { return line_buffered_; }
+
+    // Append prefix + line + '\n'
+    void write_line(std::string_view prefix, std::string_view line);
+
+    // Queue an already formatted block without copying it. The block is
+    // replaced by an empty recycled buffer the caller can keep filling.
+    void write_block(std::string& block);
+
+    // Write out everything queued so far
+    void flush();
+
+    // True once a write has failed; later output is dropped
+    bool failed() const { return failed_; }
+
+private:
+    void seal_fill_buffer();
+    void maybe_flush();
+    std::string take_spare();
+
+    int fd_;
+    size_t flush_threshold_;
+    bool line_buffered_ = false;
+    bool failed_ = false;
+
+    std::string fill_;                 // buffer write_line appends to
+    std::vector<std::string> queued_;  // sealed buffers awaiting writev
+    size_t queued_bytes_ = 0;
+    std::vector<std::string> spares_;  // emptied buffers kept for reuse
+};
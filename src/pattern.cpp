@@ -0,0 +1,271 @@
+#include "pattern.hpp"
+
+#include <iterator>
+#include <stdexcept>
+
+// Recursive-descent parser producing the Node tree for a pattern
+struct PatternParser {
+    std::string_view pattern;
+    int pos = 0;
+    int group_count = 0;
+    bool has_backrefs = false;
+
+    bool at_end() const { return pos >= static_cast<int>(pattern.length()); }
+
+    std::runtime_error error(const char* what) const {
+        return std::runtime_error(std::string(what) + " in pattern '" + std::string(pattern) + "'");
+    }
+
+    // Parse alternatives separated by | until ')' or end of pattern
+    std::vector<std::vector<Node>> parse_alternatives() {
+        std::vector<std::vector<Node>> alternatives(1);
+        while (!at_end() && pattern[pos] != ')') {
+            if (pattern[pos] == '|') {
+                alternatives.emplace_back(); // start next branch
+                pos++;
+                continue;
+            }
+            alternatives.back().push_back(parse_element());
+        }
+        return alternatives;
+    }
+
+    // Read one class member, expanding \d and \w into `shorthand`.
+    // Returns false when the member was a shorthand rather than a single byte.
+    bool read_class_char(unsigned char& c, CharClass& shorthand) {
+        if (pattern[pos] == '\\' && pos + 1 < static_cast<int>(pattern.length())) {
+            char next = pattern[pos + 1];
+            pos += 2;
+            if (next == 'd' || next == 'w') {
+                shorthand.bits |= (next == 'd' ? digit_class() : word_class()).bits;
+                return false;
+            }
+            c = static_cast<unsigned char>(next); // escaped character is taken literally
+            return true;
+        }
+        c = static_cast<unsigned char>(pattern[pos++]);
+        return true;
+    }
+
+    // Parse character class [abc], [^abc] or [a-z0-9] into a bitmap
+    CharClass parse_char_class() {
+        pos++; // Skip '['
+        bool negated = false;
+        if (!at_end() && pattern[pos] == '^') {
+            negated = true;
+            pos++;
+        }
+
+        CharClass char_class;
+        while (!at_end() && pattern[pos] != ']') {
+            unsigned char first;
+            if (!read_class_char(first, char_class)) {
+                continue;
+            }
+
+            // A '-' between two members forms a range; leading or trailing '-' is literal
+            bool is_range = pos + 1 < static_cast<int>(pattern.length()) && pattern[pos] == '-' && pattern[pos + 1] != ']';
+            if (!is_range) {
+                char_class.set(first);
+                continue;
+            }
+            pos++; // Skip '-'
+
+            unsigned char last;
+            if (!read_class_char(last, char_class) || last < first) {
+                throw error("Invalid range end");
+            }
+            char_class.set_range(first, last);
+        }
+        if (at_end()) {
+            throw error("Unmatched [");
+        }
+        pos++; // Skip ']'
+
+        if (negated) char_class.bits.flip();
+        char_class.build_tables();
+        return char_class;
+    }
+
+    // Parse a single element (char, escape, class, group or anchor) and its quantifier
+    Node parse_element() {
+        Node node;
+        char c = pattern[pos];
+
+        if (c == '^' || c == '$') {
+            node.kind = (c == '^') ? NodeKind::LineStart : NodeKind::LineEnd;
+            pos++;
+            return node; // anchors take no quantifier
+        }
+
+        if (c == '\\' && pos + 1 < static_cast<int>(pattern.length())) {
+            char next = pattern[pos + 1];
+            pos += 2;
+            if (next >= '1' && next <= '9') {
+                node.kind = NodeKind::Backref;
+                node.group_index = next - '1';
+                has_backrefs = true;
+                return node; // backreferences take no quantifier
+            }
+            if (next == 'd' || next == 'w') {
+                node.kind = NodeKind::Class;
+                node.char_class = (next == 'd') ? digit_class() : word_class();
+            } else {
+                node.literal = static_cast<unsigned char>(next); // literal escaped character
+            }
+        }
+        else if (c == '[') {
+            node.kind = NodeKind::Class;
+            node.char_class = parse_char_class();
+        }
+        else if (c == '(') {
+            node.kind = NodeKind::Group;
+            node.group_index = group_count++; // groups are numbered by their opening paren
+            pos++;
+            node.alternatives = parse_alternatives();
+            if (at_end()) {
+                throw error("Unmatched (");
+            }
+            pos++; // Skip ')'
+        }
+        else if (c == '.') {
+            node.kind = NodeKind::Any;
+            pos++;
+        }
+        else {
+            node.literal = static_cast<unsigned char>(c);
+            pos++;
+        }
+
+        // Check for quantifier after current element
+        if (!at_end()) {
+            char next = pattern[pos];
+            if (next == '?') node.quantifier = Quantifier::Optional;
+            else if (next == '+') node.quantifier = Quantifier::Plus;
+            else if (next == '*') node.quantifier = Quantifier::Star;
+            if (node.quantifier != Quantifier::One) pos++;
+        }
+        return node;
+    }
+};
+
+// Parse one pattern into a non-capturing group holding its top-level alternatives
+Node parse_pattern(std::string_view pattern, int& group_count, bool& has_backrefs) {
+    PatternParser parser{pattern};
+
+    Node root;
+    root.kind = NodeKind::Group;
+    root.alternatives = parser.parse_alternatives();
+
+    // A stray ')' at top level is matched literally, as in grep -E
+    while (!parser.at_end()) {
+        Node literal;
+        literal.literal = ')';
+        parser.pos++;
+        root.alternatives.back().push_back(literal);
+        std::vector<std::vector<Node>> rest = parser.parse_alternatives();
+        auto& last = root.alternatives.back();
+        last.insert(last.end(), rest.front().begin(), rest.front().end());
+        root.alternatives.insert(root.alternatives.end(), rest.begin() + 1, rest.end());
+    }
+
+    group_count = parser.group_count;
+    has_backrefs = parser.has_backrefs;
+    return root;
+}
+
+// Shift group numbers of one pattern past those of the patterns before it.
+// Backreferences to groups the pattern does not have point past every group, so they never match.
+void renumber_groups(Node& node, int offset, int own_groups, int total_groups) {
+    if (node.kind == NodeKind::Group && node.group_index >= 0) {
+        node.group_index += offset;
+    }
+    else if (node.kind == NodeKind::Backref) {
+        node.group_index = (node.group_index < own_groups) ? node.group_index + offset : total_groups;
+    }
+    for (auto& alternative : node.alternatives) {
+        for (Node& child : alternative) renumber_groups(child, offset, own_groups, total_groups);
+    }
+}
+
+// The text of an alternative made only of single literal bytes, or false if it is anything else
+bool plain_literal(const std::vector<Node>& alternative, std::string& text) {
+    text.clear();
+    for (const Node& node : alternative) {
+        if (node.kind != NodeKind::Literal || node.quantifier != Quantifier::One) return false;
+        text += static_cast<char>(node.literal);
+    }
+    return !text.empty();
+}
+
+bool contains_backref(const Node& node) {
+    if (node.kind == NodeKind::Backref) return true;
+    for (const auto& alternative : node.alternatives) {
+        for (const Node& child : alternative) {
+            if (contains_backref(child)) return true;
+        }
+    }
+    return false;
+}
+
+CompiledPattern compile_pattern(std::string_view pattern, const PatternOptions& options) {
+    std::string source(pattern);
+    return compile_patterns(std::span<const std::string>(&source, 1), options);
+}
+
+CompiledPattern compile_patterns(std::span<const std::string> patterns, const PatternOptions& options) {
+    CompiledPattern compiled;
+    compiled.backtrack_limit = options.backtrack_limit;
+    compiled.root.kind = NodeKind::Group;
+
+    // Parse each pattern on its own, then number groups across all of them
+    std::vector<Node> roots;
+    std::vector<int> group_counts;
+    for (const std::string& pattern : patterns) {
+        int group_count = 0;
+        bool has_backrefs = false;
+        roots.push_back(parse_pattern(pattern, group_count, has_backrefs));
+        group_counts.push_back(group_count);
+        compiled.group_count += group_count;
+
+        if (roots.size() > 1) compiled.source += '\n';
+        compiled.source += pattern;
+    }
+    int offset = 0;
+    for (size_t i = 0; i < roots.size(); i++) {
+        renumber_groups(roots[i], offset, group_counts[i], compiled.group_count);
+        offset += group_counts[i];
+        auto& alternatives = roots[i].alternatives;
+        compiled.root.alternatives.insert(compiled.root.alternatives.end(), std::make_move_iterator(alternatives.begin()),
+                                          std::make_move_iterator(alternatives.end()));
+    }
+
+    // Plain-string alternatives need no regex engine. A set made only of them is
+    // decided by the prefilter; many of them mixed with regexes get their own automaton.
+    Node regex_root;
+    regex_root.kind = NodeKind::Group;
+    std::vector<std::string> literals;
+    std::string text;
+    for (const auto& alternative : compiled.root.alternatives) {
+        if (plain_literal(alternative, text)) literals.push_back(text);
+        else regex_root.alternatives.push_back(alternative);
+    }
+    compiled.literal_only = regex_root.alternatives.empty();
+    if (!compiled.literal_only && literals.size() > kMaxFinderLiterals) {
+        compiled.literal_set = AhoCorasick(literals);
+    } else {
+        regex_root.alternatives = compiled.root.alternatives;
+    }
+
+    compiled.has_backrefs = contains_backref(regex_root);
+    compiled.anchored_start = !regex_root.alternatives.empty();
+    for (const auto& alternative : regex_root.alternatives) {
+        if (alternative.empty() || alternative.front().kind != NodeKind::LineStart) {
+            compiled.anchored_start = false;
+        }
+    }
+
+    compiled.program = compile_program(regex_root, compiled.group_count);
+    compiled.prefilter = Prefilter(required_literals(compiled.root));
+    return compiled;
+}
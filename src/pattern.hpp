@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "char_class.hpp"
+#include "prefilter.hpp"
+#include "program.hpp"
+
+// Kinds of elements a pattern compiles into
+enum class NodeKind {
+    Literal,    // single byte
+    Any,        // .
+    Class,      // [abc], [^abc], \d, \w
+    Group,      // (a|b), also used for the top-level alternation
+    Backref,    // \1 .. \9
+    LineStart,  // ^
+    LineEnd     // $
+};
+
+// Repetition applied to an element
+enum class Quantifier {
+    One,        // no quantifier
+    Optional,   // ?
+    Plus,       // +
+    Star        // *
+};
+
+// One parsed pattern element with its quantifier
+struct Node {
+    NodeKind kind = NodeKind::Literal;
+    Quantifier quantifier = Quantifier::One;
+    unsigned char literal = 0;                    // Literal
+    CharClass char_class;                         // Class (negation already applied)
+    int group_index = -1;                         // Group: capture slot, -1 if non-capturing. Backref: referenced slot
+    std::vector<std::vector<Node>> alternatives;  // Group: one sequence per | branch
+};
+
+// Backtracking steps allowed per line before the line is skipped
+constexpr size_t kDefaultBacktrackLimit = 10'000'000;
+
+// Settings fixed when a pattern is compiled
+struct PatternOptions {
+    size_t backtrack_limit = kDefaultBacktrackLimit;  // steps per line for backreference patterns, 0 for no limit
+};
+
+// A pattern parsed once and reused for every line. It is not modified by
+// matching, so one instance can be shared by any number of threads, each
+// bringing its own MatchScratch.
+struct CompiledPattern {
+    std::string source;           // the patterns, one per line
+    Node root;                    // non-capturing group holding the top-level alternatives of every pattern
+    int group_count = 0;          // number of capturing groups, numbered across patterns
+    bool literal_only = false;    // every alternative is a plain string, so a prefilter hit is a match
+    AhoCorasick literal_set;      // plain-string alternatives taken out of program when there are many
+    bool anchored_start = false;  // every alternative in program begins with ^
+    bool has_backrefs = false;    // program contains a backreference
+    Program program;              // instruction form of the remaining alternatives, for the regex engines
+    Prefilter prefilter;          // literals every match must contain
+    size_t backtrack_limit = kDefaultBacktrackLimit;  // from PatternOptions
+};
+
+// Parse a pattern string; throws std::runtime_error on malformed input
+CompiledPattern compile_pattern(std::string_view pattern, const PatternOptions& options = {});
+
+// Compile several patterns into one that matches a line when any of them does.
+// Each pattern keeps its own group numbering for backreferences. An empty
+// list matches nothing.
+CompiledPattern compile_patterns(std::span<const std::string> patterns, const PatternOptions& options = {});
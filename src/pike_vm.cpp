@@ -0,0 +1,127 @@
+#include "pike_vm.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void PikeVM::ThreadList::reset(int program_size, int slot_count) {
+    if (static_cast<int>(sparse.size()) < program_size) {
+        sparse.resize(program_size);
+        dense.resize(program_size);
+    }
+    if (static_cast<int>(slots.size()) < program_size * slot_count) {
+        slots.resize(program_size * slot_count);
+    }
+    size = 0;
+}
+
+bool PikeVM::ThreadList::contains(int pc) const {
+    int index = sparse[pc];
+    return index < size && dense[index] == pc;
+}
+
+int PikeVM::ThreadList::insert(int pc) {
+    sparse[pc] = size;
+    dense[size] = pc;
+    return size++;
+}
+
+// Follow empty transitions from pc, storing a thread at every consuming instruction
+void PikeVM::add_thread(ThreadList& list, int pc, int pos, int* slots) {
+    if (list.contains(pc)) {
+        return; // already reached with higher priority
+    }
+    int index = list.insert(pc);
+    const Instruction& inst = program_->code[pc];
+
+    switch (inst.op) {
+        case Opcode::Jump:
+            add_thread(list, inst.x, pos, slots);
+            break;
+        case Opcode::Split:
+            add_thread(list, inst.x, pos, slots);
+            add_thread(list, inst.y, pos, slots);
+            break;
+        case Opcode::Save: {
+            int saved = slots[inst.x];
+            slots[inst.x] = pos;
+            add_thread(list, pc + 1, pos, slots);
+            slots[inst.x] = saved;
+            break;
+        }
+        case Opcode::RepeatStart:
+        case Opcode::RepeatCheck:
+            // Progress guards only matter to the backtracker; the thread list already dedupes
+            add_thread(list, pc + 1, pos, slots);
+            break;
+        case Opcode::AssertStart:
+            if (pos == 0) add_thread(list, pc + 1, pos, slots);
+            break;
+        case Opcode::AssertEnd:
+            if (pos == static_cast<int>(input_.size())) add_thread(list, pc + 1, pos, slots);
+            break;
+        default: {
+            int slot_count = program_->slot_count;
+            std::memcpy(&list.slots[index * slot_count], slots, slot_count * sizeof(int));
+            break;
+        }
+    }
+}
+
+bool PikeVM::search(const Program& program, std::string_view input, bool anchored_start, int* slots) {
+    program_ = &program;
+    input_ = input;
+
+    int program_size = static_cast<int>(program.code.size());
+    int slot_count = program.slot_count;
+    current_.reset(program_size, slot_count);
+    next_.reset(program_size, slot_count);
+    scratch_slots_.assign(slot_count, -1);
+
+    bool matched = false;
+    int length = static_cast<int>(input.size());
+
+    for (int pos = 0; pos <= length; pos++) {
+        // Start a new lowest-priority thread at every offset until a match is found
+        if (!matched && (pos == 0 || !anchored_start)) {
+            std::fill(scratch_slots_.begin(), scratch_slots_.end(), -1);
+            add_thread(current_, 0, pos, scratch_slots_.data());
+        }
+        if (current_.size == 0) {
+            break;
+        }
+
+        next_.size = 0;
+        for (int i = 0; i < current_.size; i++) {
+            int pc = current_.dense[i];
+            const Instruction& inst = program.code[pc];
+            int* thread_slots = &current_.slots[i * slot_count];
+
+            if (inst.op == Opcode::Match) {
+                matched = true;
+                if (!slots) {
+                    return true; // caller only needs a yes/no answer
+                }
+                std::memcpy(slots, thread_slots, slot_count * sizeof(int));
+                break; // lower-priority threads can no longer win
+            }
+            if (pos >= length) {
+                continue;
+            }
+
+            unsigned char c = static_cast<unsigned char>(input[pos]);
+            bool consumes = false;
+            switch (inst.op) {
+                case Opcode::Byte:  consumes = (c == inst.byte); break;
+                case Opcode::Any:   consumes = true; break;
+                case Opcode::Class: consumes = program.classes[inst.x].test(c); break;
+                default: break;
+            }
+            if (consumes) {
+                add_thread(next_, pc + 1, pos + 1, thread_slots);
+            }
+        }
+        std::swap(current_, next_);
+        next_.size = 0;
+    }
+    return matched;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "program.hpp"
+
+// Linear-time NFA simulation (Pike VM) for programs without backreferences.
+// Runs all threads in lockstep over the input, so time is O(program x input)
+// regardless of how ambiguous the pattern is. Reusable across lines.
+class PikeVM {
+public:
+    // Search input for the leftmost match. When slots is non-null it receives
+    // program.slot_count capture offsets (-1 for unset groups).
+    bool search(const Program& program, std::string_view input, bool anchored_start, int* slots = nullptr);
+
+private:
+    // Sparse set of program counters, each carrying its own capture slots
+    struct ThreadList {
+        std::vector<int> sparse;
+        std::vector<int> dense;
+        std::vector<int> slots;
+        int size = 0;
+
+        void reset(int program_size, int slot_count);
+        bool contains(int pc) const;
+        int insert(int pc);
+    };
+
+    void add_thread(ThreadList& list, int pc, int pos, int* slots);
+
+    const Program* program_ = nullptr;
+    std::string_view input_;
+    ThreadList current_;
+    ThreadList next_;
+    std::vector<int> scratch_slots_;
+};
@@ -0,0 +1,299 @@
+#include "prefetcher.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define GREP_HAVE_IO_URING 1
+#endif
+
+#include "stats.hpp"
+
+// Requests the io_uring backend keeps in flight at once
+constexpr unsigned kRingEntries = 64;
+
+#ifdef GREP_HAVE_IO_URING
+
+// Minimal io_uring over the raw system calls, enough to submit fadvise
+// requests and reap their completions from a single thread
+class IoUring {
+public:
+    ~IoUring();
+
+    // False when the kernel does not support or permit io_uring, or cannot fadvise through it
+    bool init(unsigned entries);
+
+    bool full() const { return in_flight_ == entries_; }
+    bool empty() const { return in_flight_ == 0; }
+
+    // Queue and submit POSIX_FADV_WILLNEED for the whole of fd; the completion carries fd back
+    bool submit_willneed(int fd);
+
+    // Take one completion, waiting for it if asked; returns its fd or -1 if there is
+    // none. result receives the completion's status, a negated errno on failure.
+    int reap(bool wait, int& result);
+
+private:
+    bool supports(unsigned opcode);
+
+    int ring_fd_ = -1;
+    unsigned entries_ = 0;
+    unsigned in_flight_ = 0;
+
+    void* sq_ring_ = MAP_FAILED;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = MAP_FAILED;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+};
+
+IoUring::~IoUring() {
+    if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != MAP_FAILED) munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != MAP_FAILED) munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0) close(ring_fd_);
+}
+
+bool IoUring::init(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(syscall(SYS_io_uring_setup, entries, &params));
+    if (ring_fd_ < 0) {
+        return false;
+    }
+    entries_ = params.sq_entries;
+    if (!supports(IORING_OP_FADVISE)) {
+        return false; // before Linux 5.6 every request would fail with EINVAL
+    }
+
+    // The rings are mapped separately, which every kernel version accepts
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                            ring_fd_, IORING_OFF_SQES));
+    if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    char* cq = static_cast<char*>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+// Ask the kernel which opcodes it implements. Probing arrived in the same
+// release as IORING_OP_FADVISE, so a kernel without it lacks the opcode too.
+bool IoUring::supports(unsigned opcode) {
+    constexpr unsigned kProbeOps = 256;
+    std::vector<char> buffer(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op));
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(SYS_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+        return false;
+    }
+    return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED);
+}
+
+bool IoUring::submit_willneed(int fd) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_FADVISE;
+    sqe.fd = fd;
+    sqe.off = 0;
+    sqe.len = 0; // to the end of the file
+    sqe.fadvise_advice = POSIX_FADV_WILLNEED;
+    sqe.user_data = static_cast<uint64_t>(fd);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+    for (;;) {
+        long submitted = syscall(SYS_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0);
+        if (submitted == 1) break;
+        if (submitted < 0 && errno == EINTR) continue;
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE); // take the entry back
+        return false;
+    }
+    in_flight_++;
+    return true;
+}
+
+int IoUring::reap(bool wait, int& result) {
+    for (;;) {
+        unsigned head = *cq_head_;
+        if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+            int fd = static_cast<int>(cqe.user_data);
+            result = cqe.res;
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+            in_flight_--;
+            return fd;
+        }
+        if (!wait || in_flight_ == 0) {
+            return -1;
+        }
+        long result = syscall(SYS_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (result < 0 && errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+#else
+
+// Stand-in when io_uring headers are unavailable; init() always fails
+class IoUring {
+public:
+    bool init(unsigned) { return false; }
+    bool full() const { return false; }
+    bool empty() const { return true; }
+    bool submit_willneed(int) { return false; }
+    int reap(bool, int&) { return -1; }
+};
+
+#endif
+
+Prefetcher::Prefetcher(PrefetchMode mode, uint64_t max_ahead_bytes) : mode_(mode), max_ahead_bytes_(max_ahead_bytes) {
+    if (mode_ == PrefetchMode::Auto || mode_ == PrefetchMode::IoUring) {
+        ring_ = std::make_unique<IoUring>();
+        if (ring_->init(kRingEntries)) {
+            mode_ = PrefetchMode::IoUring;
+        } else {
+            ring_.reset();
+            mode_ = PrefetchMode::Thread; // io_uring missing or blocked, e.g. by seccomp
+        }
+    }
+    if (mode_ != PrefetchMode::Off) {
+        thread_ = std::thread([this] { run(); });
+    }
+}
+
+Prefetcher::~Prefetcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+void Prefetcher::add(const std::string& path, uint64_t size) {
+    if (mode_ == PrefetchMode::Off) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back({path, size});
+    }
+    changed_.notify_one();
+}
+
+void Prefetcher::consumed(uint64_t size) {
+    if (mode_ == PrefetchMode::Off) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        consumed_bytes_ += size;
+    }
+    changed_.notify_one();
+}
+
+void Prefetcher::prefetch_with_thread(int fd, uint64_t size) {
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#ifdef __linux__
+    if (readahead(fd, 0, size) == 0) return;
+#endif
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+}
+
+// Close the descriptor of a finished io_uring request, redoing it with
+// posix_fadvise if the kernel rejected it. False if none was ready.
+bool Prefetcher::reap_ring(bool wait) {
+    int result = 0;
+    int fd = ring_->reap(wait, result);
+    if (fd < 0) {
+        return false;
+    }
+    if (result < 0) {
+        count_stat(Stat::PrefetchFallbacks);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+        if (result == -EINVAL || result == -EOPNOTSUPP) ring_usable_ = false; // no point sending more
+    }
+    close(fd);
+    return true;
+}
+
+void Prefetcher::run() {
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // With io_uring, wake up to close the descriptors of finished requests
+            bool polling = ring_ && !ring_->empty();
+            auto ready = [this] {
+                return stopping_ || (!queue_.empty() && issued_bytes_ < consumed_bytes_ + max_ahead_bytes_);
+            };
+            if (polling) changed_.wait_for(lock, std::chrono::milliseconds(1), ready);
+            else changed_.wait(lock, ready);
+            if (stopping_) break;
+            if (!ready()) {
+                lock.unlock();
+                while (reap_ring(false)) {}
+                continue;
+            }
+
+            request = std::move(queue_.front());
+            queue_.pop_front();
+            // Workers already past this point gain nothing from reading ahead
+            bool behind = consumed_bytes_ >= issued_bytes_ + request.size;
+            issued_bytes_ += request.size;
+            if (behind) continue;
+        }
+
+        int fd = ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue; // the worker reports unreadable files
+        }
+        count_stat(Stat::PrefetchedFiles);
+        if (ring_ && ring_usable_) {
+            if (ring_->full()) reap_ring(true);
+            if (ring_->submit_willneed(fd)) {
+                while (reap_ring(false)) {}
+                continue;
+            }
+        }
+        prefetch_with_thread(fd, request.size);
+        close(fd);
+    }
+
+    // Let outstanding requests finish so their descriptors can be closed
+    while (ring_ && !ring_->empty() && reap_ring(true)) {}
+}
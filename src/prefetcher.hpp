@@ -0,0 +1,69 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// How files queued for scanning are read ahead (--prefetch)
+enum class PrefetchMode {
+    Auto,     // io_uring when the kernel can fadvise through it, otherwise a thread
+    Thread,   // posix_fadvise()/readahead() from a dedicated thread
+    IoUring,  // asynchronous fadvise requests, many files in flight at once
+    Off
+};
+
+// Bytes read ahead of the files being scanned, at most
+constexpr uint64_t kDefaultPrefetchBytes = 256 << 20;
+
+class IoUring;
+
+// Read-ahead stage in front of the scanner. Files are handed over as they are
+// queued, and a thread of its own asks the kernel to start reading them, so
+// their pages are already cached when a worker maps them and the matcher
+// never copies or waits on them. Reading runs at most max_ahead_bytes ahead
+// of the files workers have started on.
+class Prefetcher {
+public:
+    explicit Prefetcher(PrefetchMode mode, uint64_t max_ahead_bytes = kDefaultPrefetchBytes);
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher&) = delete;
+    Prefetcher& operator=(const Prefetcher&) = delete;
+
+    // Queue a file that is about to be scanned
+    void add(const std::string& path, uint64_t size);
+
+    // A worker has started on a queued file of this size
+    void consumed(uint64_t size);
+
+    // Backend actually in use; Off when the stage is disabled
+    PrefetchMode mode() const { return mode_; }
+
+private:
+    struct Request {
+        std::string path;
+        uint64_t size;
+    };
+
+    void run();
+    bool reap_ring(bool wait);
+    void prefetch_with_thread(int fd, uint64_t size);
+
+    PrefetchMode mode_;
+    uint64_t max_ahead_bytes_;
+    std::unique_ptr<IoUring> ring_;  // null with the thread backend
+    bool ring_usable_ = true;        // cleared if the kernel rejects fadvise requests; prefetch thread only
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Request> queue_;
+    uint64_t issued_bytes_ = 0;    // handed to the kernel so far, or passed over
+    uint64_t consumed_bytes_ = 0;  // of files workers have started on
+    bool stopping_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,102 @@
+#include "prefilter.hpp"
+
+#include <algorithm>
+
+#include "pattern.hpp"
+
+Prefilter::Prefilter(const std::vector<std::string>& literals) {
+    if (literals.size() > kMaxFinderLiterals) {
+        multi_ = AhoCorasick(literals);
+        return;
+    }
+    for (const std::string& literal : literals) {
+        finders_.emplace_back(literal);
+    }
+}
+
+size_t Prefilter::find(std::string_view haystack, size_t from) const {
+    if (!multi_.empty()) {
+        return multi_.find(haystack, from);
+    }
+    size_t earliest = std::string_view::npos;
+    for (const LiteralFinder& finder : finders_) {
+        // A later literal only matters if it starts before the best hit so far
+        std::string_view window = haystack;
+        if (earliest != std::string_view::npos) {
+            window = haystack.substr(0, earliest + finder.needle().size() - 1);
+        }
+        size_t hit = finder.find(window, from);
+        if (hit < earliest) earliest = hit;
+    }
+    return earliest;
+}
+
+std::vector<std::string> required_literals(const std::vector<Node>& sequence);
+
+// Literals for a group: each alternative must contribute one, otherwise nothing is required
+std::vector<std::string> group_literals(const Node& group) {
+    std::vector<std::string> literals;
+    for (const auto& alternative : group.alternatives) {
+        std::vector<std::string> alt_literals = required_literals(alternative);
+        if (alt_literals.empty()) {
+            return {};
+        }
+        literals.insert(literals.end(), alt_literals.begin(), alt_literals.end());
+    }
+    std::sort(literals.begin(), literals.end());
+    literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+    return literals;
+}
+
+// Shortest member decides how selective a set is; prefer fewer members on ties
+bool better_literals(const std::vector<std::string>& candidate, const std::vector<std::string>& best) {
+    auto shortest = [](const std::vector<std::string>& set) {
+        size_t length = std::string::npos;
+        for (const std::string& literal : set) length = std::min(length, literal.size());
+        return length;
+    };
+    if (candidate.empty()) return false;
+    if (best.empty()) return true;
+    size_t candidate_length = shortest(candidate);
+    size_t best_length = shortest(best);
+    if (candidate_length != best_length) return candidate_length > best_length;
+    return candidate.size() < best.size();
+}
+
+// Scan a sequence for runs of mandatory literal bytes and mandatory groups
+std::vector<std::string> required_literals(const std::vector<Node>& sequence) {
+    std::vector<std::string> best;
+    std::string run;
+
+    auto close_run = [&]() {
+        if (!run.empty() && better_literals({run}, best)) best = {run};
+        run.clear();
+    };
+
+    for (const Node& node : sequence) {
+        bool mandatory = node.quantifier == Quantifier::One || node.quantifier == Quantifier::Plus;
+
+        if (node.kind == NodeKind::Literal && mandatory) {
+            run += static_cast<char>(node.literal);
+            if (node.quantifier == Quantifier::Plus) {
+                // Repeats may follow, but the last copy still precedes whatever comes next
+                close_run();
+                run += static_cast<char>(node.literal);
+            }
+        }
+        else if (node.kind == NodeKind::Group && mandatory) {
+            close_run();
+            std::vector<std::string> literals = group_literals(node);
+            if (better_literals(literals, best)) best = literals;
+        }
+        else {
+            close_run();
+        }
+    }
+    close_run();
+    return best;
+}
+
+std::vector<std::string> required_literals(const Node& root) {
+    return group_literals(root);
+}
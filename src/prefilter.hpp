@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aho_corasick.hpp"
+#include "literal_finder.hpp"
+
+struct Node;
+
+// Cheap screen run before the regex engines: every match of the pattern must
+// contain at least one of these literals, so input without any of them can be
+// rejected at memory bandwidth without running a matcher. Small sets are
+// searched one literal at a time with SIMD; larger ones with Aho-Corasick.
+class Prefilter {
+public:
+    Prefilter() = default;
+    explicit Prefilter(const std::vector<std::string>& literals);
+
+    // True when analysis found nothing to screen on
+    bool empty() const { return finders_.empty() && multi_.empty(); }
+
+    // Offset of a required literal at or after `from`, or npos. No line before
+    // the one holding the returned offset contains a required literal.
+    size_t find(std::string_view haystack, size_t from = 0) const;
+
+    // False only when the input certainly cannot match
+    bool may_match(std::string_view input) const { return empty() || find(input) != std::string_view::npos; }
+
+    const std::vector<LiteralFinder>& finders() const { return finders_; }
+
+private:
+    std::vector<LiteralFinder> finders_;
+    AhoCorasick multi_;  // used instead of finders_ for large sets
+};
+
+// Literal sets larger than this are not worth scanning for one by one
+constexpr size_t kMaxFinderLiterals = 16;
+
+// Derive the best set of literals one of which every match must contain
+std::vector<std::string> required_literals(const Node& root);
@@ -0,0 +1,186 @@
+#include "program.hpp"
+
+#include <atomic>
+
+#include "pattern.hpp"
+
+// Source of Program::id values
+std::atomic<uint64_t> next_program_id{1};
+
+// Emits instructions for nodes, patching jump targets as it goes
+struct ProgramBuilder {
+    Program& program;
+
+    int emit(Opcode op, int x = 0, int y = 0) {
+        Instruction inst;
+        inst.op = op;
+        inst.x = x;
+        inst.y = y;
+        program.code.push_back(inst);
+        return static_cast<int>(program.code.size()) - 1;
+    }
+
+    int next_pc() const { return static_cast<int>(program.code.size()); }
+
+    // Alternatives become a chain of splits, each branch jumping to the common exit
+    void emit_alternatives(const std::vector<std::vector<Node>>& alternatives) {
+        std::vector<int> exits;
+        for (size_t i = 0; i < alternatives.size(); i++) {
+            int split = -1;
+            if (i + 1 < alternatives.size()) {
+                split = emit(Opcode::Split);
+                program.code[split].x = next_pc();
+            }
+            for (const Node& node : alternatives[i]) {
+                emit_node(node);
+            }
+            if (split >= 0) {
+                exits.push_back(emit(Opcode::Jump));
+                program.code[split].y = next_pc();
+            }
+        }
+        for (int pc : exits) {
+            program.code[pc].x = next_pc();
+        }
+    }
+
+    // Element without its quantifier
+    void emit_single(const Node& node) {
+        switch (node.kind) {
+            case NodeKind::Literal: {
+                int pc = emit(Opcode::Byte);
+                program.code[pc].byte = node.literal;
+                break;
+            }
+            case NodeKind::Any:
+                emit(Opcode::Any);
+                break;
+            case NodeKind::Class:
+                program.classes.push_back(node.char_class);
+                emit(Opcode::Class, static_cast<int>(program.classes.size()) - 1);
+                break;
+            case NodeKind::Group:
+                if (node.group_index >= 0) emit(Opcode::Save, 2 * node.group_index + 2);
+                emit_alternatives(node.alternatives);
+                if (node.group_index >= 0) emit(Opcode::Save, 2 * node.group_index + 3);
+                break;
+            case NodeKind::Backref:
+                emit(Opcode::Backref, node.group_index);
+                break;
+            case NodeKind::LineStart:
+                emit(Opcode::AssertStart);
+                break;
+            case NodeKind::LineEnd:
+                emit(Opcode::AssertEnd);
+                break;
+        }
+    }
+
+    // Whether an element, ignoring its quantifier, can match without consuming input
+    static bool nullable_element(const Node& node) {
+        switch (node.kind) {
+            case NodeKind::Literal:
+            case NodeKind::Any:
+            case NodeKind::Class:
+                return false;
+            case NodeKind::Group:
+                for (const auto& alternative : node.alternatives) {
+                    bool all_nullable = true;
+                    for (const Node& child : alternative) {
+                        if (!nullable(child)) all_nullable = false;
+                    }
+                    if (all_nullable) return true;
+                }
+                return false;
+            default:
+                return true; // anchors, and backreferences to empty captures
+        }
+    }
+
+    static bool nullable(const Node& node) {
+        return node.quantifier == Quantifier::Optional || node.quantifier == Quantifier::Star || nullable_element(node);
+    }
+
+    // Repeated body; bodies that can match empty stop looping once an iteration consumes nothing
+    void emit_repeat_body(const Node& node, std::vector<int>& exits) {
+        if (!nullable_element(node)) {
+            emit_single(node);
+            return;
+        }
+        int loop = program.loop_count++;
+        emit(Opcode::RepeatStart, loop);
+        emit_single(node);
+        exits.push_back(emit(Opcode::RepeatCheck, loop));
+    }
+
+    // Element with its quantifier; the first split target is always the greedy branch
+    void emit_node(const Node& node) {
+        std::vector<int> exits; // RepeatCheck instructions that leave the loop
+        switch (node.quantifier) {
+            case Quantifier::One:
+                emit_single(node);
+                break;
+            case Quantifier::Optional: {
+                int split = emit(Opcode::Split, next_pc() + 1);
+                emit_single(node);
+                program.code[split].y = next_pc();
+                break;
+            }
+            case Quantifier::Plus: {
+                int body = next_pc();
+                emit_repeat_body(node, exits);
+                emit(Opcode::Split, body, next_pc() + 1);
+                break;
+            }
+            case Quantifier::Star: {
+                int split = emit(Opcode::Split, next_pc() + 1);
+                emit_repeat_body(node, exits);
+                emit(Opcode::Jump, split);
+                program.code[split].y = next_pc();
+                break;
+            }
+        }
+        for (int pc : exits) {
+            program.code[pc].y = next_pc();
+        }
+    }
+};
+
+// Partition bytes into classes such that every instruction accepts all or none of a class
+void compute_byte_classes(Program& program) {
+    std::array<bool, 257> boundary{};
+    for (const Instruction& inst : program.code) {
+        if (inst.op == Opcode::Byte) {
+            boundary[inst.byte] = true;
+            boundary[inst.byte + 1] = true;
+        }
+        else if (inst.op == Opcode::Class) {
+            const CharClass& char_class = program.classes[inst.x];
+            for (int c = 1; c < 256; c++) {
+                if (char_class.test(c) != char_class.test(c - 1)) boundary[c] = true;
+            }
+        }
+    }
+
+    int class_id = 0;
+    for (int c = 0; c < 256; c++) {
+        if (c > 0 && boundary[c]) class_id++;
+        program.byte_classes[c] = static_cast<uint8_t>(class_id);
+    }
+    program.byte_class_count = class_id + 1;
+}
+
+Program compile_program(const Node& root, int group_count) {
+    Program program;
+    program.id = next_program_id++;
+    program.slot_count = 2 * group_count + 2;
+
+    ProgramBuilder builder{program};
+    builder.emit(Opcode::Save, 0);
+    builder.emit_alternatives(root.alternatives);
+    builder.emit(Opcode::Save, 1);
+    builder.emit(Opcode::Match);
+
+    compute_byte_classes(program);
+    return program;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "char_class.hpp"
+
+struct Node;
+
+// Instruction set of the compiled NFA (Thompson construction)
+enum class Opcode {
+    Byte,         // consume one byte equal to `byte`
+    Any,          // consume any byte
+    Class,        // consume one byte in classes[x]
+    Split,        // fork to x (preferred) and y
+    Jump,         // continue at x
+    Save,         // record input position in capture slot x
+    AssertStart,  // ^
+    AssertEnd,    // $
+    Backref,      // consume the text captured by group x (backtracker only)
+    RepeatStart,  // record input position in loop slot x
+    RepeatCheck,  // continue at y if nothing was consumed since RepeatStart x
+    Match         // accept
+};
+
+struct Instruction {
+    Opcode op = Opcode::Match;
+    unsigned char byte = 0;
+    int x = 0;
+    int y = 0;
+};
+
+// Flat instruction array shared by every engine that simulates the NFA
+struct Program {
+    uint64_t id = 0;  // unique per compilation, lets engines tell when their caches are stale
+    std::vector<Instruction> code;
+    std::vector<CharClass> classes;
+    int slot_count = 0;  // 2 per capture group plus 2 for the whole match
+    int loop_count = 0;  // loop slots guarding repeats whose body can match empty
+
+    // Bytes no instruction can tell apart share a class, shrinking automaton tables
+    std::array<uint8_t, 256> byte_classes{};
+    int byte_class_count = 1;
+};
+
+// Lower a parsed group tree into a program. Slots 0/1 hold the overall match,
+// slots 2g+2/2g+3 hold capture group g.
+Program compile_program(const Node& root, int group_count);
@@ -0,0 +1,75 @@
+#include "recursive_search.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+
+#include "directory_walker.hpp"
+#include "file_scanner.hpp"
+#include "stats.hpp"
+
+// Shared state of one recursive search
+struct RecursiveSearch {
+    FileScanner scanner;
+    const TrigramIndex* index;
+    IndexCandidates candidates;  // worked out once from the posting lists, before the walk
+    std::atomic<bool> failed{false};
+
+    RecursiveSearch(const CompiledPattern& compiled, int jobs, size_t window, OutputWriter& writer,
+                    const ReportOptions& report, const ScanOptions& scan, const TrigramIndex* index)
+        : scanner(compiled, jobs, window, writer, [](const std::string& path) {
+              std::cerr << "Warning: Could not open file '" << std::filesystem::path(path) << "'" << std::endl;
+          }, report, scan),
+          index(index),
+          candidates(index ? index->candidates(trigram_query(compiled)) : IndexCandidates{}) {}
+
+    void report_error(const std::string& message) {
+        std::lock_guard<std::mutex> lock(scanner.error_mutex());
+        std::cerr << message << std::endl;
+        failed = true;
+    }
+
+    // Returns false once -q has its answer, which ends the walk
+    bool submit_file(const std::string& path) {
+        if (scanner.stopped()) {
+            return false;
+        }
+        if (index && index->is_index_file(path)) {
+            return true;
+        }
+        if (index && !index->may_match(path, candidates)) {
+            count_stat(Stat::IndexSkippedFiles);
+            return true;
+        }
+        scanner.add_file(path, path + ":");
+        return true;
+    }
+};
+
+int search_recursive(const std::vector<std::string>& roots, const CompiledPattern& compiled, int jobs, size_t window,
+                     OutputWriter& writer, const ReportOptions& report, const ScanOptions& scan,
+                     const WalkOptions& walk, const TrigramIndex* index) {
+    RecursiveSearch search(compiled, jobs, window, writer, report, scan, index);
+    DirectoryWalker walker(
+        walk, [&](const std::string& path) { return search.submit_file(path); },
+        [&](const std::string& message) { search.report_error(message); });
+
+    // Traverse on this thread while the pool scans files
+    for (const std::string& root : roots) {
+        std::error_code error;
+        bool keep_going = std::filesystem::is_regular_file(root, error) ? search.submit_file(root) : walker.walk(root);
+        if (!keep_going) break;
+    }
+    search.scanner.wait();
+
+    // -q succeeds on any match, even after errors; otherwise errors win over matches, as in grep
+    if (search.scanner.stopped()) {
+        return 0;
+    }
+    if (search.failed) {
+        return 2;
+    }
+    // Return 0 if matches found, 1 if not
+    return search.scanner.matched_lines() > 0 ? 0 : 1;
+}
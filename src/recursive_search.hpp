@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "directory_walker.hpp"
+#include "file_scanner.hpp"
+#include "output_writer.hpp"
+#include "pattern.hpp"
+#include "trigram_index.hpp"
+
+// Search every regular file under the given roots (-r) that the walk options
+// let through, on `jobs` worker threads while this thread walks the tree.
+// Output is streamed in path order, with at most `window` files or chunks
+// scanned ahead of the oldest unfinished one.
+// Files are reported as `report` asks; -q stops the walk at the first match.
+// With an index, files it shows cannot match are skipped without being opened.
+// Returns the process exit status: 0 on a match, 1 on none, 2 if the walk hit an error.
+int search_recursive(const std::vector<std::string>& roots, const CompiledPattern& compiled, int jobs, size_t window,
+                     OutputWriter& writer, const ReportOptions& report = {}, const ScanOptions& scan = {},
+                     const WalkOptions& walk = {}, const TrigramIndex* index = nullptr);
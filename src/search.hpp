@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "matcher.hpp"
+#include "stats.hpp"
+
+// Call on_match(line) for every line of buffer the pattern matches, in order,
+// until it returns false. Lines exclude their trailing '\n'. With a prefilter
+// the buffer is scanned for required literals directly, and line boundaries
+// are located only around hits. Returns false if on_match stopped the scan.
+template <typename OnMatch>
+bool for_each_matching_line(std::string_view buffer, const CompiledPattern& compiled, OnMatch&& on_match) {
+    const Prefilter& prefilter = compiled.prefilter;
+    MatchScratch& scratch = thread_scratch();
+    size_t pos = 0; // always the start of a line
+
+    while (pos < buffer.size()) {
+        size_t line_start = pos;
+        if (!prefilter.empty()) {
+            size_t hit = prefilter.find(buffer, pos);
+            if (hit == std::string_view::npos) {
+                count_stat(Stat::PrefilterSkippedBytes, buffer.size() - pos);
+                count_stat(Stat::ScannedBytes, buffer.size());
+                return true; // no remaining line can match
+            }
+            if (hit > pos) {
+                size_t newline = buffer.rfind('\n', hit - 1);
+                if (newline != std::string_view::npos && newline >= pos) line_start = newline + 1;
+            }
+            count_stat(Stat::PrefilterSkippedBytes, line_start - pos);
+        }
+
+        const void* newline = std::memchr(buffer.data() + line_start, '\n', buffer.size() - line_start);
+        size_t line_end = newline ? static_cast<const char*>(newline) - buffer.data() : buffer.size();
+
+        std::string_view line = buffer.substr(line_start, line_end - line_start);
+        if (match_candidate(line, compiled, scratch) && !on_match(line)) {
+            count_stat(Stat::ScannedBytes, std::min(line_end + 1, buffer.size()));
+            return false;
+        }
+        pos = line_end + 1;
+    }
+    count_stat(Stat::ScannedBytes, buffer.size());
+    return true;
+}
@@ -0,0 +1,535 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Compile-time counterpart of compile_pattern for patterns fixed in the source:
+//
+//     if (StaticPattern<"user_id=\\d+">::matches(line)) ...
+//
+// The pattern is parsed while the program is compiled, in the same dialect as
+// the runtime parser (literals, ., \d, \w, [...] classes, ?, +, *, groups,
+// alternation, ^ and $), and turned into a complete DFA whose tables are
+// constants in the binary. Matching a line is one table lookup per byte with
+// no engine dispatch, caches or scratch; when only one byte can move the DFA
+// out of its start state, memchr() skips ahead to it. Backreferences are not regular, so
+// patterns using them are rejected, as are patterns whose DFA would exceed
+// kMaxStaticDfaStates. Errors surface as compile errors.
+
+// Bound on DFA states; subset construction can grow exponentially in the pattern
+constexpr size_t kMaxStaticDfaStates = 4096;
+
+// Pattern text usable as a template argument
+template <size_t N>
+struct PatternString {
+    char chars[N] = {};
+
+    constexpr PatternString(const char (&text)[N]) {
+        for (size_t i = 0; i < N; i++) chars[i] = text[i];
+    }
+
+    constexpr std::string_view view() const { return std::string_view(chars, N - 1); }
+};
+
+// 256-bit byte set; std::bitset is not usable in constant expressions here
+struct StaticByteSet {
+    std::array<uint64_t, 4> words{};
+
+    constexpr bool test(unsigned char c) const { return (words[c >> 6] >> (c & 63)) & 1; }
+    constexpr void set(unsigned char c) { words[c >> 6] |= uint64_t{1} << (c & 63); }
+    constexpr void set_range(unsigned char first, unsigned char last) {
+        for (int c = first; c <= last; c++) set(static_cast<unsigned char>(c));
+    }
+    constexpr void merge(const StaticByteSet& other) {
+        for (size_t i = 0; i < words.size(); i++) words[i] |= other.words[i];
+    }
+    constexpr void flip() {
+        for (uint64_t& word : words) word = ~word;
+    }
+};
+
+constexpr StaticByteSet static_digit_set() {
+    StaticByteSet set;
+    set.set_range('0', '9');
+    return set;
+}
+
+constexpr StaticByteSet static_word_set() {
+    StaticByteSet set;
+    set.set_range('a', 'z');
+    set.set_range('A', 'Z');
+    set.set_range('0', '9');
+    set.set('_');
+    return set;
+}
+
+enum class StaticNodeKind { Bytes, Group, LineStart, LineEnd };
+enum class StaticQuantifier { One, Optional, Plus, Star };
+
+// Parsed element; literals, . and classes are all byte sets
+struct StaticNode {
+    StaticNodeKind kind = StaticNodeKind::Bytes;
+    StaticQuantifier quantifier = StaticQuantifier::One;
+    StaticByteSet bytes;
+    std::vector<std::vector<StaticNode>> alternatives;  // Group: one sequence per | branch
+};
+
+// Mirror of PatternParser in pattern.cpp, usable in constant expressions.
+// The two must accept the same syntax and read it the same way.
+struct StaticPatternParser {
+    std::string_view pattern;
+    size_t pos = 0;
+
+    constexpr bool at_end() const { return pos >= pattern.size(); }
+
+    constexpr std::vector<std::vector<StaticNode>> parse_alternatives() {
+        std::vector<std::vector<StaticNode>> alternatives(1);
+        while (!at_end() && pattern[pos] != ')') {
+            if (pattern[pos] == '|') {
+                alternatives.emplace_back();
+                pos++;
+                continue;
+            }
+            alternatives.back().push_back(parse_element());
+        }
+        return alternatives;
+    }
+
+    constexpr bool read_class_char(unsigned char& c, StaticByteSet& shorthand) {
+        if (pattern[pos] == '\\' && pos + 1 < pattern.size()) {
+            char next = pattern[pos + 1];
+            pos += 2;
+            if (next == 'd' || next == 'w') {
+                shorthand.merge(next == 'd' ? static_digit_set() : static_word_set());
+                return false;
+            }
+            c = static_cast<unsigned char>(next);
+            return true;
+        }
+        c = static_cast<unsigned char>(pattern[pos++]);
+        return true;
+    }
+
+    constexpr StaticByteSet parse_char_class() {
+        pos++; // Skip '['
+        bool negated = false;
+        if (!at_end() && pattern[pos] == '^') {
+            negated = true;
+            pos++;
+        }
+
+        StaticByteSet set;
+        while (!at_end() && pattern[pos] != ']') {
+            unsigned char first = 0;
+            if (!read_class_char(first, set)) {
+                continue;
+            }
+            bool is_range = pos + 1 < pattern.size() && pattern[pos] == '-' && pattern[pos + 1] != ']';
+            if (!is_range) {
+                set.set(first);
+                continue;
+            }
+            pos++; // Skip '-'
+
+            unsigned char last = 0;
+            if (!read_class_char(last, set) || last < first) {
+                throw std::runtime_error("Invalid range end in static pattern");
+            }
+            set.set_range(first, last);
+        }
+        if (at_end()) {
+            throw std::runtime_error("Unmatched [ in static pattern");
+        }
+        pos++; // Skip ']'
+
+        if (negated) set.flip();
+        return set;
+    }
+
+    constexpr StaticNode parse_element() {
+        StaticNode node;
+        char c = pattern[pos];
+
+        if (c == '^' || c == '$') {
+            node.kind = (c == '^') ? StaticNodeKind::LineStart : StaticNodeKind::LineEnd;
+            pos++;
+            return node;
+        }
+
+        if (c == '\\' && pos + 1 < pattern.size()) {
+            char next = pattern[pos + 1];
+            pos += 2;
+            if (next >= '1' && next <= '9') {
+                throw std::runtime_error("Backreferences are not supported in static patterns");
+            }
+            if (next == 'd' || next == 'w') {
+                node.bytes = (next == 'd') ? static_digit_set() : static_word_set();
+            } else {
+                node.bytes.set(static_cast<unsigned char>(next));
+            }
+        }
+        else if (c == '[') {
+            node.bytes = parse_char_class();
+        }
+        else if (c == '(') {
+            node.kind = StaticNodeKind::Group;
+            pos++;
+            node.alternatives = parse_alternatives();
+            if (at_end()) {
+                throw std::runtime_error("Unmatched ( in static pattern");
+            }
+            pos++; // Skip ')'
+        }
+        else if (c == '.') {
+            node.bytes.flip();
+            pos++;
+        }
+        else {
+            node.bytes.set(static_cast<unsigned char>(c));
+            pos++;
+        }
+
+        if (!at_end()) {
+            char next = pattern[pos];
+            if (next == '?') node.quantifier = StaticQuantifier::Optional;
+            else if (next == '+') node.quantifier = StaticQuantifier::Plus;
+            else if (next == '*') node.quantifier = StaticQuantifier::Star;
+            if (node.quantifier != StaticQuantifier::One) pos++;
+        }
+        return node;
+    }
+
+    // Top-level alternatives; a stray ')' is a literal, as in parse_pattern
+    constexpr std::vector<std::vector<StaticNode>> parse() {
+        std::vector<std::vector<StaticNode>> alternatives = parse_alternatives();
+        while (!at_end()) {
+            StaticNode paren;
+            paren.bytes.set(')');
+            pos++;
+            alternatives.back().push_back(paren);
+            std::vector<std::vector<StaticNode>> rest = parse_alternatives();
+            for (StaticNode& node : rest.front()) alternatives.back().push_back(std::move(node));
+            for (size_t i = 1; i < rest.size(); i++) alternatives.push_back(std::move(rest[i]));
+        }
+        return alternatives;
+    }
+};
+
+enum class StaticOp { Bytes, Split, AssertStart, AssertEnd, Match };
+
+struct StaticInstruction {
+    StaticOp op = StaticOp::Match;
+    StaticByteSet bytes;  // Bytes
+    int x = 0;            // successor; Split also continues at y
+    int y = 0;
+};
+
+// Thompson NFA built back to front: each element is compiled knowing the
+// instruction that follows it, so no jumps need patching
+struct StaticNfaBuilder {
+    std::vector<StaticInstruction> code;
+
+    constexpr int emit(StaticOp op, int x = 0, int y = 0) {
+        StaticInstruction instruction;
+        instruction.op = op;
+        instruction.x = x;
+        instruction.y = y;
+        code.push_back(instruction);
+        return static_cast<int>(code.size()) - 1;
+    }
+
+    constexpr int compile_sequence(const std::vector<StaticNode>& sequence, int next) {
+        for (size_t i = sequence.size(); i-- > 0;) {
+            next = compile_node(sequence[i], next);
+        }
+        return next;
+    }
+
+    constexpr int compile_alternatives(const std::vector<std::vector<StaticNode>>& alternatives, int next) {
+        int entry = compile_sequence(alternatives.back(), next);
+        for (size_t i = alternatives.size() - 1; i-- > 0;) {
+            int branch = compile_sequence(alternatives[i], next);
+            entry = emit(StaticOp::Split, branch, entry);
+        }
+        return entry;
+    }
+
+    constexpr int compile_single(const StaticNode& node, int next) {
+        switch (node.kind) {
+            case StaticNodeKind::Bytes: {
+                int pc = emit(StaticOp::Bytes, next);
+                code[pc].bytes = node.bytes;
+                return pc;
+            }
+            case StaticNodeKind::Group:
+                return compile_alternatives(node.alternatives, next);
+            case StaticNodeKind::LineStart:
+                return emit(StaticOp::AssertStart, next);
+            case StaticNodeKind::LineEnd:
+                return emit(StaticOp::AssertEnd, next);
+        }
+        return next;
+    }
+
+    // Loops whose body can match empty become epsilon cycles, which closures tolerate
+    constexpr int compile_node(const StaticNode& node, int next) {
+        switch (node.quantifier) {
+            case StaticQuantifier::One:
+                return compile_single(node, next);
+            case StaticQuantifier::Optional: {
+                int body = compile_single(node, next);
+                return emit(StaticOp::Split, body, next);
+            }
+            case StaticQuantifier::Star: {
+                int split = emit(StaticOp::Split, 0, next);
+                code[split].x = compile_single(node, split);
+                return split;
+            }
+            case StaticQuantifier::Plus: {
+                int split = emit(StaticOp::Split, 0, next);
+                int body = compile_single(node, split);
+                code[split].x = body;
+                return body;
+            }
+        }
+        return next;
+    }
+};
+
+// DFA states 0 and 1 are fixed: nothing can match any more, and a match was found
+constexpr uint16_t kStaticDeadState = 0;
+constexpr uint16_t kStaticMatchState = 1;
+
+// Result of subset construction, before it is copied into fixed-size tables
+struct StaticDfaBuild {
+    std::array<uint8_t, 256> byte_classes{};
+    size_t class_count = 0;
+    std::vector<uint16_t> next;         // state * class_count + class
+    std::vector<bool> accept_at_end;    // the line matches if it ends in this state
+    uint16_t start = 0;
+    int start_exit = -1;  // the only byte leaving the start state, or -1
+    bool empty_line_matches = false;
+};
+
+// Each DFA state is the set of NFA instructions waiting on input: byte
+// consumers and $ assertions. A search may begin at any offset, so the NFA
+// start is added after every byte; ^ is only passed at offset 0.
+struct StaticDfaBuilder {
+    const std::vector<StaticInstruction>& code;
+    int nfa_start;
+    std::vector<std::vector<uint8_t>> states;  // membership per NFA instruction
+
+    constexpr void close(int pc, bool at_start, bool at_end, std::vector<uint8_t>& set,
+                         std::vector<uint8_t>& visited) const {
+        std::vector<int> stack{pc};
+        while (!stack.empty()) {
+            int current = stack.back();
+            stack.pop_back();
+            if (visited[current]) continue;
+            visited[current] = 1;
+            const StaticInstruction& instruction = code[current];
+            switch (instruction.op) {
+                case StaticOp::Bytes:
+                case StaticOp::Match:
+                    set[current] = 1;
+                    break;
+                case StaticOp::Split:
+                    stack.push_back(instruction.y);
+                    stack.push_back(instruction.x);
+                    break;
+                case StaticOp::AssertStart:
+                    if (at_start) stack.push_back(instruction.x);
+                    break;
+                case StaticOp::AssertEnd:
+                    if (at_end) stack.push_back(instruction.x);
+                    else set[current] = 1; // decided once the line ends
+                    break;
+            }
+        }
+    }
+
+    constexpr bool has_match(const std::vector<uint8_t>& set) const {
+        for (size_t pc = 0; pc < code.size(); pc++) {
+            if (set[pc] && code[pc].op == StaticOp::Match) return true;
+        }
+        return false;
+    }
+
+    constexpr bool empty(const std::vector<uint8_t>& set) const {
+        for (uint8_t member : set) {
+            if (member) return false;
+        }
+        return true;
+    }
+
+    // Index of a state, adding it if new
+    constexpr uint16_t intern(const std::vector<uint8_t>& set) {
+        if (has_match(set)) return kStaticMatchState;
+        if (empty(set)) return kStaticDeadState;
+        for (size_t i = 2; i < states.size(); i++) {
+            if (states[i] == set) return static_cast<uint16_t>(i);
+        }
+        if (states.size() == kMaxStaticDfaStates) {
+            throw std::runtime_error("Static pattern needs too many DFA states");
+        }
+        states.push_back(set);
+        return static_cast<uint16_t>(states.size() - 1);
+    }
+
+    constexpr bool accepts_at_end(const std::vector<uint8_t>& set) const {
+        std::vector<uint8_t> closed(code.size());
+        std::vector<uint8_t> visited(code.size());
+        for (size_t pc = 0; pc < code.size(); pc++) {
+            if (set[pc] && code[pc].op == StaticOp::AssertEnd) {
+                close(code[pc].x, false, true, closed, visited);
+            }
+        }
+        return has_match(closed);
+    }
+
+    constexpr StaticDfaBuild build() {
+        StaticDfaBuild dfa;
+
+        // Bytes that every byte set treats alike share a column
+        std::array<uint8_t, 256> representative{};
+        dfa.class_count = 1;
+        for (const StaticInstruction& instruction : code) {
+            if (instruction.op != StaticOp::Bytes) continue;
+            std::array<int, 512> renumbered{};
+            renumbered.fill(-1);
+            size_t count = 0;
+            for (int c = 0; c < 256; c++) {
+                int key = dfa.byte_classes[c] * 2 + (instruction.bytes.test(static_cast<unsigned char>(c)) ? 1 : 0);
+                if (renumbered[key] < 0) renumbered[key] = static_cast<int>(count++);
+                dfa.byte_classes[c] = static_cast<uint8_t>(renumbered[key]);
+            }
+            dfa.class_count = count;
+        }
+        for (int c = 255; c >= 0; c--) representative[dfa.byte_classes[c]] = static_cast<uint8_t>(c);
+
+        std::vector<uint8_t> initial(code.size());
+        std::vector<uint8_t> visited(code.size());
+        close(nfa_start, true, true, initial, visited);
+        dfa.empty_line_matches = has_match(initial);
+
+        states.assign(2, std::vector<uint8_t>(code.size()));
+        std::fill(initial.begin(), initial.end(), 0);
+        std::fill(visited.begin(), visited.end(), 0);
+        close(nfa_start, true, false, initial, visited);
+        dfa.start = intern(initial);
+
+        for (size_t state = 0; state < states.size(); state++) {
+            for (size_t byte_class = 0; byte_class < dfa.class_count; byte_class++) {
+                if (state < 2) {
+                    dfa.next.push_back(static_cast<uint16_t>(state)); // both are final
+                    continue;
+                }
+                unsigned char c = representative[byte_class];
+                std::vector<uint8_t> next(code.size());
+                std::fill(visited.begin(), visited.end(), 0);
+                for (size_t pc = 0; pc < code.size(); pc++) {
+                    const StaticInstruction& instruction = code[pc];
+                    if (states[state][pc] && instruction.op == StaticOp::Bytes && instruction.bytes.test(c)) {
+                        close(instruction.x, false, false, next, visited);
+                    }
+                }
+                close(nfa_start, false, false, next, visited);
+                dfa.next.push_back(intern(next));
+            }
+            dfa.accept_at_end.push_back(state >= 2 && accepts_at_end(states[state]));
+        }
+
+        if (dfa.start >= 2) {
+            int exits = 0;
+            for (int c = 0; c < 256; c++) {
+                if (dfa.next[dfa.start * dfa.class_count + dfa.byte_classes[c]] != dfa.start) {
+                    exits++;
+                    dfa.start_exit = c;
+                }
+            }
+            if (exits != 1) dfa.start_exit = -1;
+        }
+        return dfa;
+    }
+};
+
+constexpr StaticDfaBuild build_static_dfa(std::string_view pattern) {
+    StaticPatternParser parser{pattern};
+    std::vector<std::vector<StaticNode>> alternatives = parser.parse();
+    StaticNfaBuilder nfa;
+    int match = nfa.emit(StaticOp::Match);
+    int start = nfa.compile_alternatives(alternatives, match);
+    StaticDfaBuilder builder{nfa.code, start, {}};
+    return builder.build();
+}
+
+// Tables of a finished DFA, sized to fit
+template <size_t States, size_t Classes>
+struct StaticDfa {
+    std::array<uint8_t, 256> byte_classes{};
+    std::array<std::array<uint16_t, Classes>, States> next{};
+    std::array<bool, States> accept_at_end{};
+    uint16_t start = 0;
+    int start_exit = -1;
+    bool empty_line_matches = false;
+};
+
+template <PatternString Pattern>
+class StaticPattern {
+public:
+    static constexpr std::string_view source() { return Pattern.view(); }
+
+    // Same answer as match_string() on compile_pattern(source()) for any line
+    static constexpr bool matches(std::string_view line) {
+        if (line.empty()) {
+            return kDfa.empty_line_matches;
+        }
+        const char* p = line.data();
+        const char* end = p + line.size();
+        uint16_t state = kDfa.start;
+        while (p < end && state > kStaticMatchState) {
+            if constexpr (kDfa.start_exit >= 0) {
+                if !consteval {
+                    if (state == kDfa.start) {
+                        p = static_cast<const char*>(std::memchr(p, kDfa.start_exit, end - p));
+                        if (!p) break;
+                    }
+                }
+            }
+            state = kDfa.next[state][kDfa.byte_classes[static_cast<unsigned char>(*p++)]];
+        }
+        return state == kStaticMatchState || kDfa.accept_at_end[state];
+    }
+
+    // Number of DFA states, for sizing checks
+    static constexpr size_t state_count() { return kShape.first; }
+
+private:
+    static constexpr std::pair<size_t, size_t> kShape = [] {
+        StaticDfaBuild built = build_static_dfa(Pattern.view());
+        return std::pair<size_t, size_t>(built.accept_at_end.size(), built.class_count);
+    }();
+
+    static constexpr StaticDfa<kShape.first, kShape.second> kDfa = [] {
+        StaticDfaBuild built = build_static_dfa(Pattern.view());
+        StaticDfa<kShape.first, kShape.second> dfa;
+        dfa.byte_classes = built.byte_classes;
+        for (size_t state = 0; state < kShape.first; state++) {
+            for (size_t byte_class = 0; byte_class < kShape.second; byte_class++) {
+                dfa.next[state][byte_class] = built.next[state * kShape.second + byte_class];
+            }
+            dfa.accept_at_end[state] = built.accept_at_end[state];
+        }
+        dfa.start = built.start;
+        dfa.start_exit = built.start_exit;
+        dfa.empty_line_matches = built.empty_line_matches;
+        return dfa;
+    }();
+};
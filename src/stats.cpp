@@ -0,0 +1,118 @@
+#include "stats.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+
+thread_local ThreadStats thread_stats;
+
+std::atomic<bool> stats_on{false};
+std::mutex totals_mutex;
+uint64_t totals[static_cast<size_t>(Stat::Count)] = {};
+
+// Display name and whether the counter is a maximum rather than a sum
+struct StatInfo {
+    const char* name;
+    bool peak;
+};
+
+const StatInfo kStatInfo[] = {
+    {"files_opened", false},
+    {"files_skipped", false},
+    {"index_skipped_files", false},
+    {"binary_files", false},
+    {"prefetched_files", false},
+    {"prefetch_fallbacks", false},
+    {"compressed_files", false},
+    {"decompressed_bytes", false},
+    {"bytes_read", false},
+    {"lines_read", false},
+    {"scanned_bytes", false},
+    {"prefilter_skipped_bytes", false},
+    {"match_calls", false},
+    {"dfa_searches", false},
+    {"dfa_gave_up", false},
+    {"pike_searches", false},
+    {"backtrack_searches", false},
+    {"backtrack_steps", false},
+    {"backtrack_starts", false},
+    {"literal_set_searches", false},
+    {"traversal_seconds", false},
+    {"io_seconds", false},
+    {"decompress_seconds", false},
+    {"match_seconds", false},
+    {"output_seconds", false},
+    {"peak_pending_output_bytes", true},
+    {"peak_dfa_cache_bytes", true},
+};
+static_assert(sizeof(kStatInfo) / sizeof(kStatInfo[0]) == static_cast<size_t>(Stat::Count));
+
+void merge_into(uint64_t* target, const uint64_t* source) {
+    for (size_t i = 0; i < static_cast<size_t>(Stat::Count); i++) {
+        if (kStatInfo[i].peak) {
+            if (source[i] > target[i]) target[i] = source[i];
+        } else {
+            target[i] += source[i];
+        }
+    }
+}
+
+ThreadStats::~ThreadStats() {
+    std::lock_guard<std::mutex> lock(totals_mutex);
+    merge_into(totals, values);
+}
+
+bool stats_enabled() {
+    return stats_on.load(std::memory_order_relaxed);
+}
+
+void enable_stats() {
+    stats_on = true;
+}
+
+void StatTimer::stop() {
+    if (!enabled_) {
+        return;
+    }
+    enabled_ = false;
+    auto elapsed = std::chrono::steady_clock::now() - start_;
+    if (elapsed.count() > 0) {
+        count_stat(stat_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+}
+
+std::string format_stats(bool json, double wall_seconds) {
+    uint64_t values[static_cast<size_t>(Stat::Count)] = {};
+    {
+        std::lock_guard<std::mutex> lock(totals_mutex);
+        merge_into(values, totals);
+    }
+    merge_into(values, thread_stats.values);
+
+    std::string out = json ? "{" : "Stats:\n";
+    char line[128];
+    for (size_t i = 0; i < static_cast<size_t>(Stat::Count); i++) {
+        Stat stat = static_cast<Stat>(i);
+        bool is_time = stat >= Stat::TraversalNanos && stat <= Stat::OutputNanos;
+        if (is_time) {
+            double seconds = values[i] / 1e9;
+            std::snprintf(line, sizeof(line), json ? "\"%s\": %.6f, " : "  %-26s %.6f\n", kStatInfo[i].name, seconds);
+        } else {
+            std::snprintf(line, sizeof(line), json ? "\"%s\": %llu, " : "  %-26s %llu\n", kStatInfo[i].name,
+                          static_cast<unsigned long long>(values[i]));
+        }
+        out += line;
+    }
+
+    // Share of the searched bytes the prefilter let the matcher skip; both count
+    // decompressed bytes under -z, so the rate stays within 0..1
+    uint64_t bytes = values[static_cast<size_t>(Stat::ScannedBytes)];
+    double rejection = bytes ? static_cast<double>(values[static_cast<size_t>(Stat::PrefilterSkippedBytes)]) / bytes : 0;
+    std::snprintf(line, sizeof(line), json ? "\"%s\": %.4f, " : "  %-26s %.4f\n",
+                  "prefilter_skip_rate", rejection);
+    out += line;
+    std::snprintf(line, sizeof(line), json ? "\"%s\": %.6f}\n" : "  %-26s %.6f\n", "wall_seconds",
+                  wall_seconds);
+    out += line;
+    return out;
+}
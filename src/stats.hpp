@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Counters reported by --stats. Times are summed over all threads, so with
+// several workers they can exceed the wall-clock time.
+enum class Stat {
+    FilesOpened,
+    FilesSkipped,           // could not be opened
+    IndexSkippedFiles,      // ruled out by the trigram index without being opened
+    BinaryFiles,            // files with a NUL byte near the start
+    PrefetchedFiles,        // files read ahead of the scanner
+    PrefetchFallbacks,      // io_uring read-ahead requests the kernel failed, redone with posix_fadvise
+    CompressedFiles,        // inputs decompressed with -z
+    DecompressedBytes,
+    BytesRead,
+    LinesRead,              // counted only while stats are enabled
+    ScannedBytes,           // bytes searched for matches, after any decompression
+    PrefilterSkippedBytes,  // bytes never handed to the matcher
+    MatchCalls,             // lines handed to the matcher
+    DfaSearches,
+    DfaGaveUp,
+    PikeSearches,
+    BacktrackSearches,
+    BacktrackSteps,
+    BacktrackStarts,        // start offsets tried by the backtracker
+    LiteralSetSearches,     // lines checked against plain-string patterns
+    TraversalNanos,
+    IoNanos,
+    DecompressNanos,        // spent by the -z decompression threads
+    MatchNanos,
+    OutputNanos,
+    PeakPendingOutput,      // bytes held back for ordered output, maximum
+    PeakDfaCache,           // bytes of one thread's DFA cache, maximum
+    Count
+};
+
+// Per-thread counter block; folded into the process totals when its thread exits
+struct ThreadStats {
+    uint64_t values[static_cast<size_t>(Stat::Count)] = {};
+    ~ThreadStats();
+};
+
+extern thread_local ThreadStats thread_stats;
+
+// Whether timers are running; counters are always kept since they are cheap
+bool stats_enabled();
+void enable_stats();
+
+inline void count_stat(Stat stat, uint64_t amount = 1) {
+    thread_stats.values[static_cast<size_t>(stat)] += amount;
+}
+
+inline void record_peak(Stat stat, uint64_t value) {
+    uint64_t& peak = thread_stats.values[static_cast<size_t>(stat)];
+    if (value > peak) peak = value;
+}
+
+inline uint64_t thread_stat(Stat stat) {
+    return thread_stats.values[static_cast<size_t>(stat)];
+}
+
+// Adds the elapsed time of its scope to a *Nanos counter when stats are enabled
+class StatTimer {
+public:
+    explicit StatTimer(Stat stat) : stat_(stat), enabled_(stats_enabled()) {
+        if (enabled_) start_ = std::chrono::steady_clock::now();
+    }
+    ~StatTimer() { stop(); }
+
+    StatTimer(const StatTimer&) = delete;
+    StatTimer& operator=(const StatTimer&) = delete;
+
+    // Leave out time already accounted to another counter
+    void exclude(uint64_t nanos) { start_ += std::chrono::nanoseconds(nanos); }
+
+    // Record now instead of at the end of the scope
+    void stop();
+
+private:
+    Stat stat_;
+    bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Totals over every thread that has exited plus the calling thread, as
+// indented text or as a JSON object
+std::string format_stats(bool json, double wall_seconds);
@@ -0,0 +1,80 @@
+#include "stream_search.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "input.hpp"
+#include "search.hpp"
+#include "stats.hpp"
+
+size_t search_stream(int fd, const std::string& label, const CompiledPattern& compiled, OutputWriter& writer,
+                     const ReportOptions& report) {
+    StreamReader reader(fd);
+    bool binary = false;
+    size_t checked = 0; // leading bytes looked at for a NUL
+    size_t count = 0;
+    bool keep_going = report.max_count > 0;
+    while (keep_going) {
+        std::string_view lines;
+        {
+            StatTimer timer(Stat::IoNanos);
+            if (!reader.next(lines)) break;
+        }
+        count_stat(Stat::BytesRead, lines.size());
+        if (stats_enabled()) {
+            count_stat(Stat::LinesRead, std::count(lines.begin(), lines.end(), '\n'));
+        }
+        // Decided block by block rather than waiting for kBinaryCheckBytes of a slow stream
+        if (report.binary_files != BinaryFiles::Text && checked < kBinaryCheckBytes) {
+            std::string_view head = lines.substr(0, kBinaryCheckBytes - checked);
+            checked += head.size();
+            if (looks_binary(head)) {
+                binary = true;
+                count_stat(Stat::BinaryFiles);
+                if (report.binary_files == BinaryFiles::Skip) break;
+            }
+        }
+
+        uint64_t output_before = thread_stat(Stat::OutputNanos);
+        StatTimer timer(Stat::MatchNanos);
+        keep_going = for_each_matching_line(lines, compiled, [&](std::string_view line) {
+            count++;
+            if (report.mode == ReportMode::Lines && !binary) {
+                StatTimer output_timer(Stat::OutputNanos);
+                writer.write_line("", line);
+            } else if (report.mode != ReportMode::Count) {
+                return false; // a binary match, -l and -q are settled by the first line
+            }
+            return count < report.max_count;
+        });
+        timer.exclude(thread_stat(Stat::OutputNanos) - output_before);
+        timer.stop();
+
+        if (reader.drained()) {
+            // The next read may wait on the writer of the stream; show what was found so far
+            StatTimer output_timer(Stat::OutputNanos);
+            writer.flush();
+        }
+    }
+    if (reader.failed()) {
+        throw std::runtime_error("Could not read '" + label + "': " + std::strerror(errno));
+    }
+
+    if (report.mode == ReportMode::Count) {
+        writer.write_line("", std::to_string(count));
+    }
+    else if (report.mode == ReportMode::FileNames && count > 0) {
+        writer.write_line("", label);
+    }
+    else if (report.mode == ReportMode::Lines && binary && count > 0) {
+        writer.write_line("Binary file " + label, " matches");
+    }
+    if (size_t skipped = take_skipped_lines()) {
+        std::cerr << "Warning: Skipped " << skipped << " line(s) in '" << label
+                  << "' that exceeded the backtracking limit" << std::endl;
+    }
+    return count;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "file_scanner.hpp"
+#include "output_writer.hpp"
+#include "pattern.hpp"
+
+// Search a stream such as standard input as it arrives, reporting it under
+// `label` exactly as FileScanner reports a single file. Lines are matched a
+// block at a time with constant memory, and output is flushed whenever the
+// next read may block, so matches appear while the stream is still open.
+// Returns the number of matching lines reported; throws std::runtime_error
+// if the stream cannot be read.
+size_t search_stream(int fd, const std::string& label, const CompiledPattern& compiled, OutputWriter& writer,
+                     const ReportOptions& report = {});
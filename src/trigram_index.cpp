@@ -0,0 +1,470 @@
+#include "trigram_index.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <unordered_set>
+#include <sys/stat.h>
+
+#include "decompressor.hpp"
+#include "directory_walker.hpp"
+#include "prefilter.hpp"
+#include "stats.hpp"
+#include "work_stealing_pool.hpp"
+
+// Start of every index file; the layout after it is in host byte order, as
+// the index is a local cache rather than an interchange format:
+//   u64 file count, then per file (its id is its position)
+//     u32 key length, key, i64 mtime (ns), u64 size
+//   u64 trigram count, then per trigram in ascending order a posting row
+//     u32 trigram, u32 file count, u64 offset and u64 length of its list
+//   posting lists, each the file ids as varint deltas; offsets start here
+constexpr char kIndexMagic[8] = {'G', 'R', 'E', 'P', 'I', 'D', 'X', '2'};
+
+constexpr size_t kPostingRowSize = 24;
+
+// Number of distinct trigrams, one bit each in the extraction bitmap
+constexpr size_t kTrigramSpace = size_t{1} << 24;
+
+TrigramQuery trigram_query(const CompiledPattern& compiled) {
+    TrigramQuery query;
+    for (const std::string& literal : required_literals(compiled.root)) {
+        if (literal.size() < 3) {
+            return {}; // a short literal can be anywhere, so no file can be ruled out
+        }
+        query.alternatives.push_back(extract_trigrams(literal));
+    }
+    return query;
+}
+
+std::vector<uint32_t> extract_trigrams(std::string_view contents) {
+    // Bitmap of trigrams seen in this buffer; only the bits set are cleared afterwards
+    thread_local std::vector<uint64_t> seen(kTrigramSpace / 64);
+
+    std::vector<uint32_t> trigrams;
+    uint32_t trigram = 0;
+    for (size_t i = 0; i < contents.size(); i++) {
+        trigram = ((trigram << 8) | static_cast<unsigned char>(contents[i])) & (kTrigramSpace - 1);
+        if (i < 2) continue;
+        uint64_t& word = seen[trigram / 64];
+        uint64_t bit = uint64_t{1} << (trigram % 64);
+        if (!(word & bit)) {
+            word |= bit;
+            trigrams.push_back(trigram);
+        }
+    }
+    for (uint32_t seen_trigram : trigrams) {
+        seen[seen_trigram / 64] = 0;
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    return trigrams;
+}
+
+void append_varint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+// Ascending values as varint deltas
+std::string encode_deltas(std::span<const uint32_t> values) {
+    std::string encoded;
+    uint32_t previous = 0;
+    for (uint32_t value : values) {
+        append_varint(encoded, value - previous);
+        previous = value;
+    }
+    return encoded;
+}
+
+// Decode count values into out; false if the data is truncated
+bool decode_deltas(std::string_view encoded, uint32_t count, std::vector<uint32_t>& out) {
+    out.clear();
+    uint32_t value = 0;
+    size_t pos = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t delta = 0;
+        for (int shift = 0;; shift += 7) {
+            if (pos >= encoded.size() || shift > 28) return false;
+            unsigned char byte = static_cast<unsigned char>(encoded[pos++]);
+            delta |= static_cast<uint32_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        value += delta;
+        out.push_back(value);
+    }
+    return true;
+}
+
+// Modification time and size of a file, following symlinks as the search does
+bool file_signature(const std::string& path, int64_t& mtime_ns, uint64_t& size) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+    mtime_ns = static_cast<int64_t>(info.st_mtim.tv_sec) * 1'000'000'000 + info.st_mtim.tv_nsec;
+    size = static_cast<uint64_t>(info.st_size);
+    return true;
+}
+
+// Reads fixed-size fields from the mapped index, failing once past the end
+struct IndexReader {
+    std::string_view data;
+    size_t pos = 0;
+
+    template <typename T>
+    bool read(T& value) {
+        if (data.size() - pos < sizeof(T)) return false;
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool read_bytes(size_t length, std::string_view& bytes) {
+        if (data.size() - pos < length) return false;
+        bytes = data.substr(pos, length);
+        pos += length;
+        return true;
+    }
+};
+
+IndexKeys::IndexKeys(const std::string& index_path) {
+    std::error_code error;
+    cwd_ = std::filesystem::current_path(error);
+    root_ = (cwd_ / index_path).lexically_normal().parent_path();
+}
+
+std::string IndexKeys::key(const std::string& path) const {
+    return (cwd_ / path).lexically_normal().lexically_relative(root_).string();
+}
+
+bool TrigramIndex::load(const std::string& path) {
+    files_.clear();
+    ids_.clear();
+    if (!file_.open(path)) {
+        return false;
+    }
+    path_ = path;
+    keys_ = IndexKeys(path);
+
+    IndexReader reader{file_.contents()};
+    std::string_view magic;
+    uint64_t file_count = 0;
+    bool ok = reader.read_bytes(sizeof(kIndexMagic), magic) &&
+              magic == std::string_view(kIndexMagic, sizeof(kIndexMagic)) && reader.read(file_count);
+    for (uint64_t i = 0; ok && i < file_count; i++) {
+        uint32_t key_length = 0;
+        FileEntry entry;
+        ok = reader.read(key_length) && reader.read_bytes(key_length, entry.key) && reader.read(entry.mtime_ns) &&
+             reader.read(entry.size);
+        if (ok) {
+            ids_.emplace(entry.key, static_cast<uint32_t>(files_.size()));
+            files_.push_back(entry);
+        }
+    }
+    uint64_t trigram_count = 0;
+    ok = ok && reader.read(trigram_count) && trigram_count <= kTrigramSpace &&
+         reader.read_bytes(trigram_count * kPostingRowSize, postings_table_);
+    if (!ok) {
+        files_.clear();
+        ids_.clear();
+        file_.close();
+        return false;
+    }
+    postings_data_ = reader.data.substr(reader.pos);
+    return true;
+}
+
+bool TrigramIndex::posting_list(uint32_t trigram, uint32_t& count, std::vector<uint32_t>* ids) const {
+    // Binary search over the fixed-size rows, which are sorted by trigram
+    size_t low = 0;
+    size_t high = postings_table_.size() / kPostingRowSize;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        IndexReader row{postings_table_, middle * kPostingRowSize};
+        uint32_t row_trigram = 0;
+        row.read(row_trigram);
+        if (row_trigram == trigram) {
+            uint64_t offset = 0;
+            uint64_t length = 0;
+            row.read(count);
+            row.read(offset);
+            row.read(length);
+            if (offset > postings_data_.size() || length > postings_data_.size() - offset) return false;
+            return !ids || decode_deltas(postings_data_.substr(offset, length), count, *ids);
+        }
+        if (row_trigram < trigram) low = middle + 1;
+        else high = middle;
+    }
+    return false;
+}
+
+IndexCandidates TrigramIndex::candidates(const TrigramQuery& query) const {
+    IndexCandidates result;
+    if (query.empty()) {
+        return result;
+    }
+    result.all = false;
+    result.files.assign(files_.size(), false);
+
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> list;
+    std::vector<uint32_t> common;
+    for (const std::vector<uint32_t>& alternative : query.alternatives) {
+        // Intersect from the shortest list up, so the running result starts small
+        std::vector<std::pair<uint32_t, uint32_t>> lists;  // file count, trigram
+        bool complete = true;
+        for (uint32_t trigram : alternative) {
+            uint32_t count = 0;
+            complete = complete && posting_list(trigram, count, nullptr);
+            lists.emplace_back(count, trigram);
+        }
+        if (!complete) {
+            continue; // some trigram occurs in no indexed file
+        }
+        std::sort(lists.begin(), lists.end());
+
+        for (size_t i = 0; i < lists.size(); i++) {
+            uint32_t count = 0;
+            if (!posting_list(lists[i].second, count, i == 0 ? &ids : &list)) {
+                return IndexCandidates{}; // damaged index: rule nothing out
+            }
+            if (i > 0) {
+                common.clear();
+                std::set_intersection(ids.begin(), ids.end(), list.begin(), list.end(), std::back_inserter(common));
+                ids.swap(common);
+            }
+            if (ids.empty()) break;
+        }
+        for (uint32_t id : ids) {
+            if (id < result.files.size()) result.files[id] = true;
+        }
+    }
+    return result;
+}
+
+std::vector<std::vector<uint32_t>> TrigramIndex::trigrams_by_file() const {
+    std::vector<std::vector<uint32_t>> trigrams(files_.size());
+    std::vector<uint32_t> ids;
+    for (size_t row = 0; row < postings_table_.size() / kPostingRowSize; row++) {
+        IndexReader reader{postings_table_, row * kPostingRowSize};
+        uint32_t trigram = 0;
+        uint32_t count = 0;
+        reader.read(trigram);
+        if (!posting_list(trigram, count, &ids)) continue;
+        for (uint32_t id : ids) {
+            if (id < trigrams.size()) trigrams[id].push_back(trigram);
+        }
+    }
+    return trigrams;
+}
+
+int64_t TrigramIndex::unchanged_file(const std::string& key, const std::string& path) const {
+    auto found = ids_.find(key);
+    if (found == ids_.end()) {
+        return -1;
+    }
+    const FileEntry& entry = files_[found->second];
+    int64_t mtime_ns = 0;
+    uint64_t size = 0;
+    if (!file_signature(path, mtime_ns, size) || mtime_ns != entry.mtime_ns || size != entry.size) {
+        return -1;
+    }
+    return found->second;
+}
+
+bool TrigramIndex::is_index_file(const std::string& path) const {
+    std::filesystem::path candidate(path);
+    if (candidate.filename() != std::filesystem::path(path_).filename()) {
+        return false;
+    }
+    std::error_code error;
+    return std::filesystem::equivalent(candidate, path_, error);
+}
+
+bool TrigramIndex::may_match(const std::string& path, const IndexCandidates& candidates) const {
+    if (candidates.all) {
+        return true;
+    }
+    std::string key = keys_.key(path);
+    auto found = ids_.find(key);
+    if (found == ids_.end() || candidates.files[found->second]) {
+        return true; // new since indexing, or it holds the trigrams
+    }
+    return unchanged_file(key, path) < 0; // ruled out, unless the file has changed since
+}
+
+// One file of an index being built
+struct IndexRecord {
+    std::string path;
+    std::string key;
+    int64_t mtime_ns = 0;
+    uint64_t size = 0;
+    uint32_t trigram_count = 0;
+    std::string encoded;  // its trigrams as varint deltas
+    bool readable = false;
+};
+
+// Regular files a search of roots would visit, in path order
+std::vector<std::string> collect_files(const std::vector<std::string>& roots, const WalkOptions& walk,
+                                       const std::string& index_path) {
+    std::vector<std::string> files;
+    std::error_code error;
+    DirectoryWalker walker(
+        walk,
+        [&](const std::string& path) {
+            std::error_code ignored;
+            if (!std::filesystem::equivalent(path, index_path, ignored)) files.push_back(path);
+            return true;
+        },
+        [](const std::string& message) { std::cerr << "Warning: " << message << std::endl; });
+    for (const std::string& root : roots) {
+        if (std::filesystem::is_regular_file(root, error)) files.push_back(root);
+        else walker.walk(root);
+    }
+    return files;
+}
+
+// Posting lists of the readable records, whose ids are their positions among
+// them: ids of the files holding trigrams[k] are postings[starts[k], starts[k + 1])
+void invert_records(const std::vector<IndexRecord>& records, std::vector<uint32_t>& trigrams,
+                    std::vector<uint64_t>& starts, std::vector<uint32_t>& postings) {
+    // Count the files holding each trigram, then reuse the counts as positions in `trigrams`
+    std::vector<uint32_t> slots(kTrigramSpace, 0);
+    std::vector<uint32_t> file_trigrams;
+    for (const IndexRecord& record : records) {
+        if (!record.readable || !decode_deltas(record.encoded, record.trigram_count, file_trigrams)) continue;
+        for (uint32_t trigram : file_trigrams) slots[trigram]++;
+    }
+    uint64_t total = 0;
+    for (uint32_t trigram = 0; trigram < kTrigramSpace; trigram++) {
+        if (slots[trigram] == 0) continue;
+        trigrams.push_back(trigram);
+        starts.push_back(total);
+        total += slots[trigram];
+        slots[trigram] = static_cast<uint32_t>(trigrams.size() - 1);
+    }
+    starts.push_back(total);
+
+    // Records are visited in id order, so every list comes out sorted
+    postings.resize(total);
+    std::vector<uint64_t> next(starts.begin(), starts.end() - 1);
+    uint32_t id = 0;
+    for (const IndexRecord& record : records) {
+        if (!record.readable || !decode_deltas(record.encoded, record.trigram_count, file_trigrams)) continue;
+        for (uint32_t trigram : file_trigrams) postings[next[slots[trigram]]++] = id;
+        id++;
+    }
+}
+
+bool build_index(const std::vector<std::string>& roots, const WalkOptions& walk, const std::string& index_path,
+                 int jobs, const TrigramIndex* previous, std::string& error) {
+    // Overlapping roots reach some files twice; their keys tell them apart
+    IndexKeys keys(index_path);
+    std::vector<IndexRecord> records;
+    std::unordered_set<std::string> seen;
+    for (std::string& path : collect_files(roots, walk, index_path)) {
+        std::string key = keys.key(path);
+        if (!seen.insert(key).second) continue;
+        records.push_back({std::move(path), std::move(key)});
+    }
+
+    std::vector<std::vector<uint32_t>> previous_trigrams;
+    if (previous) previous_trigrams = previous->trigrams_by_file();
+    {
+        WorkStealingPool pool(jobs);
+        for (IndexRecord& record : records) {
+            if (!file_signature(record.path, record.mtime_ns, record.size)) {
+                continue;
+            }
+
+            // Unchanged files keep their previous trigrams
+            int64_t old = previous ? previous->unchanged_file(record.key, record.path) : -1;
+            if (old >= 0) {
+                record.trigram_count = static_cast<uint32_t>(previous_trigrams[old].size());
+                record.encoded = encode_deltas(previous_trigrams[old]);
+                record.readable = true;
+                continue;
+            }
+
+            pool.submit([&record] {
+                InputFile file;
+                {
+                    StatTimer timer(Stat::IoNanos);
+                    if (!file.open(record.path)) {
+                        count_stat(Stat::FilesSkipped);
+                        return;
+                    }
+                }
+                count_stat(Stat::FilesOpened);
+                count_stat(Stat::BytesRead, file.contents().size());
+                if (detect_compression(file.contents()) != Compression::None) {
+                    return; // left out, so searches with -z always read them
+                }
+                std::vector<uint32_t> trigrams = extract_trigrams(file.contents());
+                record.trigram_count = static_cast<uint32_t>(trigrams.size());
+                record.encoded = encode_deltas(trigrams);
+                record.readable = true;
+            });
+        }
+        pool.wait();
+    }
+
+    std::vector<uint32_t> trigrams;
+    std::vector<uint64_t> starts;
+    std::vector<uint32_t> postings;
+    invert_records(records, trigrams, starts, postings);
+
+    // Write next to the final path and rename, so readers never see a partial index
+    std::string temp_path = index_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            error = "Could not write index '" + temp_path + "': " + std::strerror(errno);
+            return false;
+        }
+        auto write = [&out](const auto& value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+
+        uint64_t file_count = std::count_if(records.begin(), records.end(), [](const IndexRecord& r) { return r.readable; });
+        out.write(kIndexMagic, sizeof(kIndexMagic));
+        write(file_count);
+        for (const IndexRecord& record : records) {
+            if (!record.readable) continue;
+            write(static_cast<uint32_t>(record.key.size()));
+            out.write(record.key.data(), record.key.size());
+            write(record.mtime_ns);
+            write(record.size);
+        }
+
+        std::string lists;
+        write(static_cast<uint64_t>(trigrams.size()));
+        for (size_t k = 0; k < trigrams.size(); k++) {
+            std::span<const uint32_t> ids(postings.data() + starts[k], starts[k + 1] - starts[k]);
+            uint64_t offset = lists.size();
+            lists += encode_deltas(ids);
+            write(trigrams[k]);
+            write(static_cast<uint32_t>(ids.size()));
+            write(offset);
+            write(static_cast<uint64_t>(lists.size() - offset));
+        }
+        out.write(lists.data(), lists.size());
+        if (!out.flush()) {
+            error = "Could not write index '" + temp_path + "'";
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), index_path.c_str()) != 0) {
+        error = "Could not replace index '" + index_path + "': " + std::strerror(errno);
+        std::error_code ignored;
+        std::filesystem::remove(temp_path, ignored);
+        return false;
+    }
+    return true;
+}
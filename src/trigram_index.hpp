@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "directory_walker.hpp"
+#include "input.hpp"
+#include "pattern.hpp"
+
+// Default location of the index written by --index build|update
+constexpr const char* kDefaultIndexFile = ".grep_index";
+
+// Trigrams a file must contain to hold a match: all trigrams of at least one
+// of the pattern's required literals. Empty when the pattern has no literal of
+// three bytes or more to go on, in which case every file is a candidate.
+struct TrigramQuery {
+    std::vector<std::vector<uint32_t>> alternatives;  // sorted trigrams of each required literal
+
+    bool empty() const { return alternatives.empty(); }
+};
+
+TrigramQuery trigram_query(const CompiledPattern& compiled);
+
+// Sorted, distinct trigrams of a buffer, each packed as three bytes into a uint32_t
+std::vector<uint32_t> extract_trigrams(std::string_view contents);
+
+// Files of an index that may hold a match, by file id
+struct IndexCandidates {
+    bool all = true;          // nothing could be ruled out
+    std::vector<bool> files;  // when not all: whether each indexed file is a candidate
+};
+
+// Maps the paths a build or search visits to index keys: relative to the
+// directory holding the index, with "." and ".." resolved, so "./x", "x" and
+// "dir/../x" all name the same entry whatever directory the walk started from
+class IndexKeys {
+public:
+    IndexKeys() = default;
+    explicit IndexKeys(const std::string& index_path);
+
+    std::string key(const std::string& path) const;
+
+private:
+    std::filesystem::path cwd_;
+    std::filesystem::path root_;
+};
+
+// On-disk inverted index: for every trigram, the sorted ids of the files that
+// contain it, plus the key, modification time and size of each file. A query
+// intersects the posting lists of its trigrams once, before the walk. Files
+// left out are skipped only while they keep their indexed time and size, and
+// files the index does not know are always read, so searches through the
+// index return exactly what a full scan would.
+class TrigramIndex {
+public:
+    // Map an index file; false if it is missing or malformed
+    bool load(const std::string& path);
+
+    // Files holding every trigram of at least one of the query's alternatives
+    IndexCandidates candidates(const TrigramQuery& query) const;
+
+    // False only when path is indexed, not a candidate, and unchanged since indexing
+    bool may_match(const std::string& path, const IndexCandidates& candidates) const;
+
+    // Whether path names the loaded index file itself, which a search should pass over
+    bool is_index_file(const std::string& path) const;
+
+    size_t size() const { return files_.size(); }
+
+private:
+    friend bool build_index(const std::vector<std::string>&, const WalkOptions&, const std::string&, int,
+                            const TrigramIndex*, std::string&);
+
+    struct FileEntry {
+        std::string_view key;  // inside file_
+        int64_t mtime_ns = 0;
+        uint64_t size = 0;
+    };
+
+    // Id of the entry for key if the file at path still has its indexed time and size, or -1
+    int64_t unchanged_file(const std::string& key, const std::string& path) const;
+
+    // Decode the posting list of a trigram; false if it has none or the index is damaged
+    bool posting_list(uint32_t trigram, uint32_t& count, std::vector<uint32_t>* ids) const;
+
+    // Trigrams of every file, rebuilt from the posting lists for an update
+    std::vector<std::vector<uint32_t>> trigrams_by_file() const;
+
+    std::string path_;
+    IndexKeys keys_;
+    InputFile file_;
+    std::vector<FileEntry> files_;
+    std::unordered_map<std::string_view, uint32_t> ids_;
+    std::string_view postings_table_;  // one fixed-size row per trigram, ascending
+    std::string_view postings_data_;   // the delta-encoded file ids the rows point into
+};
+
+// Index every regular file under roots that the walk options let through, in
+// parallel on `jobs` threads, and write the result to index_path. With a
+// previous index, files whose time and size are unchanged reuse their old
+// trigrams instead of being read (update). Returns false and sets error on failure.
+bool build_index(const std::vector<std::string>& roots, const WalkOptions& walk, const std::string& index_path,
+                 int jobs, const TrigramIndex* previous, std::string& error);
@@ -0,0 +1,114 @@
+#include "work_stealing_pool.hpp"
+
+thread_local int worker_index = -1;
+thread_local const void* worker_pool = nullptr;
+
+int default_job_count() {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? static_cast<int>(cores) : 1;
+}
+
+WorkStealingPool::WorkStealingPool(int threads) {
+    if (threads < 1) threads = 1;
+    for (int i = 0; i < threads; i++) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 0; i < threads; i++) {
+        threads_.emplace_back(&WorkStealingPool::worker_loop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+int WorkStealingPool::current_worker() {
+    return worker_index;
+}
+
+void WorkStealingPool::submit(Task task) {
+    // Workers keep spawned work local so related tasks stay on one core
+    int target = (worker_pool == this) ? worker_index
+                                       : static_cast<int>(next_queue_++ % queues_.size());
+    // Count the task before it becomes visible, or a worker could pop and
+    // finish it first and take the counters below zero
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        queued_++;
+        unfinished_++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    work_available_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(state_mutex_);
+    all_done_.wait(lock, [this] { return unfinished_ == 0; });
+}
+
+bool WorkStealingPool::pop_local(int index, Task& task) {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int index, Task& task) {
+    int count = static_cast<int>(queues_.size());
+    for (int offset = 1; offset < count; offset++) {
+        Queue& victim = *queues_[(index + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::worker_loop(int index) {
+    worker_index = index;
+    worker_pool = this;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex_);
+            work_available_.wait(lock, [this] { return queued_ > 0 || stopping_; });
+            if (queued_ == 0 && stopping_) {
+                return;
+            }
+        }
+
+        Task task;
+        if (!pop_local(index, task) && !steal(index, task)) {
+            continue; // another worker took it first
+        }
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            queued_--;
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (--unfinished_ == 0) {
+            all_done_.notify_all();
+        }
+    }
+}
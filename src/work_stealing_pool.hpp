@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task deque. A worker runs
+// its newest task first and, when its deque is empty, steals the oldest task
+// from another worker. This balances trees with very uneven file sizes.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Queue a task (which must not throw); from inside a worker it goes to
+    // that worker's own deque
+    void submit(Task task);
+
+    // Block until every submitted task, including tasks they submitted, has run
+    void wait();
+
+    int size() const { return static_cast<int>(threads_.size()); }
+
+    // Index of the calling worker thread, or -1 outside any pool
+    static int current_worker();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop_local(int index, Task& task);
+    bool steal(int index, Task& task);
+    void worker_loop(int index);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex state_mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable all_done_;
+    size_t queued_ = 0;    // tasks sitting in deques, guarded by state_mutex_
+    size_t unfinished_ = 0; // queued or running, guarded by state_mutex_
+    bool stopping_ = false;
+    std::atomic<unsigned> next_queue_{0};
+};
+
+// Number of workers to use when the user did not ask for a specific count
+int default_job_count();
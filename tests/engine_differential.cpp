@@ -0,0 +1,202 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "backtracker.hpp"
+#include "lazy_dfa.hpp"
+#include "matcher.hpp"
+#include "pattern.hpp"
+#include "pike_vm.hpp"
+
+// Cross-checks every engine that can run a pattern against match_string on
+// the same lines: the Pike VM, the lazy DFA (with a cache small enough to make
+// it flush and give up), and the backtracker with and without its visited bitset.
+
+// Regular patterns, run through every engine
+const char* const kRegularPatterns[] = {
+    "a", "ab|b", "a?b+", "(a|b)*1", "^a", "b$", "^$", "$^", "^(ab)+$", "[a-c]+1", "[^a]b", "\\d+", "\\w+ x",
+    "a.b", "()", "a|", "a**", "(^a|b$)", "a$|^b", "x*", "[ab]*[ab]1", "(a|ab)(x|bx)", "^(a|ab)(1|b1)?$",
+    // Loops whose body can match empty
+    "(a*)*b", "(a*)*b$", "(a|)+x", "(|a)+b", "(a*|b)*x$", "(a+|b+)*x$", "(a(b|)?)+$", "(a*)+$", "^(a?)*$",
+    "((a*)*|b)*1", "(()|a)*b",
+};
+
+// Patterns with backreferences, which only the backtracker can run
+const char* const kBackrefPatterns[] = {
+    "(a)\\1", "(\\w+) \\1", "(a|aa)+\\1x", "(a*)\\1b", "^(a*)\\1$", "(a|b)*\\1", "(.)(.)\\2\\1",
+    "^(ab|a)(b*)\\2$", "((a)|b)+\\2", "(a*)*\\1x", "(|a)+\\1b", "(a|)+\\1$", "^(a*)*\\1$", "(a|b)\\1|x1",
+};
+
+// Lines with a known answer, so engines that agree on a wrong result are caught too
+struct Expectation {
+    const char* pattern;
+    const char* line;
+    bool matches;
+};
+
+const Expectation kExpectations[] = {
+    {"(a*)*b", "aab", true},           {"(a*)*b", "aaac", false},        {"(a|)+c", "c", true},
+    {"(a|)+c", "aab", false},          {"(|a)+b", "aab", true},          {"^(a?)*$", "aaa", true},
+    {"^(a?)*$", "aba", false},         {"(a+|b+)*x$", "abx", true},      {"(a+|b+)*x$", "xa", false},
+    {"a|", "b", true},                 {"^$", "", true},                 {"^$", "a", false},
+    {"$^", "", true},                  {"x*", "", true},                 {"(\\w+) \\1", "foo foo", true},
+    {"(\\w+) \\1", "foo bar", false},  {"(\\w+) \\1", "ab b", true},     {"(a|aa)+\\1x", "aaax", true},
+    {"(a|aa)+\\1x", "ax", false},      {"^(a*)\\1$", "aaaa", true},      {"^(a*)\\1$", "aaa", false},
+    {"(a*)*\\1x", "x", true},          {"(.)(.)\\2\\1", "xabba", true},  {"(.)(.)\\2\\1", "abab", false},
+    {"^(ab|a)(b*)\\2$", "abbb", true}, {"^(ab|a)(b*)\\2$", "ab", true},  {"^(ab|a)(b*)\\2$", "abbb1", false},
+};
+
+// Lines over a small alphabet: every one up to kExhaustiveLength, then random longer ones
+constexpr std::string_view kExhaustiveAlphabet = "ab1x ";
+constexpr size_t kExhaustiveLength = 6;
+constexpr std::string_view kRandomAlphabet = "aab1x _.";
+constexpr size_t kRandomLines = 3000;
+constexpr size_t kRandomMaxLength = 24;
+
+// Enough for short lines; the backtracker without memo can be exponential on the random ones
+constexpr size_t kStepLimit = 2'000'000;
+
+// Small enough that the DFA flushes its cache and gives up on some lines
+constexpr size_t kTinyDfaBudget = 512;
+
+std::vector<std::string> make_lines() {
+    std::vector<std::string> lines{""};
+    size_t level_start = 0;
+    for (size_t length = 1; length <= kExhaustiveLength; length++) {
+        size_t level_end = lines.size();
+        for (size_t i = level_start; i < level_end; i++) {
+            for (char c : kExhaustiveAlphabet) lines.push_back(lines[i] + c);
+        }
+        level_start = level_end;
+    }
+
+    std::mt19937 random(20240601);
+    std::uniform_int_distribution<size_t> length(0, kRandomMaxLength);
+    std::uniform_int_distribution<size_t> letter(0, kRandomAlphabet.size() - 1);
+    for (size_t i = 0; i < kRandomLines; i++) {
+        std::string line(length(random), ' ');
+        for (char& c : line) c = kRandomAlphabet[letter(random)];
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+const char* verdict(bool matched) {
+    return matched ? "match" : "no match";
+}
+
+// Engines kept across lines, as MatchScratch keeps them
+struct Engines {
+    MatchScratch scratch;
+    PikeVM pike_vm;
+    LazyDFA lazy_dfa;
+    LazyDFA tiny_dfa{kTinyDfaBudget};
+    Backtracker backtracker;
+    Backtracker plain_backtracker{0};  // visited bitset never fits, so nothing is memoized
+};
+
+struct Totals {
+    size_t checks = 0;
+    size_t failures = 0;
+    size_t dfa_gave_up = 0;
+    size_t step_limited = 0;
+};
+
+void report_failure(Totals& totals, const char* pattern, std::string_view line, const char* engine, bool expected,
+                    bool actual) {
+    totals.failures++;
+    if (totals.failures <= 20) {
+        std::fprintf(stderr, "FAIL %s on \"%.*s\": %s says %s, expected %s\n", pattern, static_cast<int>(line.size()),
+                     line.data(), engine, verdict(actual), verdict(expected));
+    }
+}
+
+void check_backtracker(Totals& totals, const char* pattern, std::string_view line, const char* engine,
+                       Backtracker& backtracker, const CompiledPattern& compiled, bool expected) {
+    BacktrackResult result = backtracker.search(compiled.program, line, compiled.anchored_start, kStepLimit);
+    if (result == BacktrackResult::StepLimit) {
+        totals.step_limited++;
+        return;
+    }
+    totals.checks++;
+    if ((result == BacktrackResult::Match) != expected) {
+        report_failure(totals, pattern, line, engine, expected, result == BacktrackResult::Match);
+    }
+}
+
+void check_dfa(Totals& totals, const char* pattern, std::string_view line, const char* engine, LazyDFA& dfa,
+               const CompiledPattern& compiled, bool expected) {
+    DfaResult result = dfa.search(compiled.program, line, compiled.anchored_start);
+    if (result == DfaResult::GaveUp) {
+        totals.dfa_gave_up++;
+        return;
+    }
+    totals.checks++;
+    if ((result == DfaResult::Match) != expected) {
+        report_failure(totals, pattern, line, engine, expected, result == DfaResult::Match);
+    }
+}
+
+// Compare every applicable engine with match_string, or with expected when given
+void check_line(Totals& totals, Engines& engines, const char* pattern, const CompiledPattern& compiled,
+                std::string_view line, const bool* expected = nullptr) {
+    bool reference = match_string(line, compiled, engines.scratch);
+    engines.scratch.take_skipped_lines();
+    if (expected) {
+        totals.checks++;
+        if (reference != *expected) report_failure(totals, pattern, line, "match_string", *expected, reference);
+    }
+
+    check_backtracker(totals, pattern, line, "backtracker", engines.backtracker, compiled, reference);
+    check_backtracker(totals, pattern, line, "backtracker without memo", engines.plain_backtracker, compiled,
+                      reference);
+    if (compiled.has_backrefs) {
+        return;
+    }
+
+    totals.checks++;
+    bool pike = engines.pike_vm.search(compiled.program, line, compiled.anchored_start);
+    if (pike != reference) report_failure(totals, pattern, line, "PikeVM", reference, pike);
+    check_dfa(totals, pattern, line, "LazyDFA", engines.lazy_dfa, compiled, reference);
+    check_dfa(totals, pattern, line, "LazyDFA with a tiny cache", engines.tiny_dfa, compiled, reference);
+}
+
+void check_pattern(Totals& totals, Engines& engines, const char* pattern, const std::vector<std::string>& lines) {
+    CompiledPattern compiled = compile_pattern(pattern, PatternOptions{0});
+    if (!compiled.literal_set.empty()) {
+        std::fprintf(stderr, "FAIL %s: plain-string alternatives left the program\n", pattern);
+        totals.failures++;
+        return;
+    }
+    for (const std::string& line : lines) {
+        check_line(totals, engines, pattern, compiled, line);
+    }
+}
+
+int main() {
+    std::vector<std::string> lines = make_lines();
+    Totals totals;
+    Engines engines;
+
+    for (const char* pattern : kRegularPatterns) {
+        CompiledPattern compiled = compile_pattern(pattern);
+        if (compiled.has_backrefs) {
+            std::fprintf(stderr, "FAIL %s: listed as regular but has a backreference\n", pattern);
+            totals.failures++;
+        }
+        check_pattern(totals, engines, pattern, lines);
+    }
+    for (const char* pattern : kBackrefPatterns) {
+        check_pattern(totals, engines, pattern, lines);
+    }
+    for (const Expectation& expectation : kExpectations) {
+        CompiledPattern compiled = compile_pattern(expectation.pattern, PatternOptions{0});
+        check_line(totals, engines, expectation.pattern, compiled, expectation.line, &expectation.matches);
+    }
+
+    std::printf("%zu checks on %zu lines, %zu failures (%zu DFA give-ups and %zu step-limited searches not compared)\n",
+                totals.checks, lines.size(), totals.failures, totals.dfa_gave_up, totals.step_limited);
+    return totals.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+
+#include "directory_walker.hpp"
+#include "ignore_rules.hpp"
+
+// Checks glob_match, IgnoreRules and the walker's use of them against tables
+// of gitignore semantics, so a change to the matching shows up as a changed
+// set of searched files.
+
+struct GlobCase {
+    const char* pattern;
+    const char* text;
+    bool matches;
+};
+
+const GlobCase kGlobCases[] = {
+    {"*.log", "a.log", true},        {"*.log", "dir/a.log", false},   {"*", "", true},
+    {"a/**/b", "a/b", true},         {"a/**/b", "a/x/y/b", true},     {"a/**/b", "a/xb", false},
+    {"**/foo", "foo", true},         {"**/foo", "x/y/foo", true},     {"logs/**", "logs/a/b", true},
+    {"logs/**", "logs", false},      {"a**b", "axyb", true},          {"a**b", "a/b", false},
+    {"[a-c].txt", "b.txt", true},    {"[a-c].txt", "d.txt", false},   {"[!a-c].txt", "d.txt", true},
+    {"[^a-c].txt", "a.txt", false},  {"[]a]", "]", true},             {"[a-]", "-", true},
+    {"a[", "a[", true},              {"[/]", "/", false},             {"?.md", "a.md", true},
+    {"?", "/", false},               {"\\*", "*", true},              {"\\*", "a", false},
+    {"*.tar.*", "x.tar.gz", true},   {"*a*b", "xaybab", true},        {"*a*b", "xayba", false},
+};
+
+struct RuleCase {
+    const char* rules;
+    const char* path;
+    bool is_directory;
+    IgnoreMatch expected;
+};
+
+const RuleCase kRuleCases[] = {
+    // Later rules override earlier ones
+    {"*.log\n!keep.log", "keep.log", false, IgnoreMatch::Whitelist},
+    {"*.log\n!keep.log", "x.log", false, IgnoreMatch::Ignore},
+    {"*.log\n!keep.log", "sub/keep.log", false, IgnoreMatch::Whitelist},
+    {"!keep.log\n*.log", "keep.log", false, IgnoreMatch::Ignore},
+    // A leading or inner / anchors the glob to the ignore file's directory
+    {"/root-only", "root-only", false, IgnoreMatch::Ignore},
+    {"/root-only", "sub/root-only", false, IgnoreMatch::None},
+    {"doc/*.txt", "doc/a.txt", false, IgnoreMatch::Ignore},
+    {"doc/*.txt", "x/doc/a.txt", false, IgnoreMatch::None},
+    {"doc/*.txt", "doc/sub/a.txt", false, IgnoreMatch::None},
+    {"a/**/b", "a/x/y/b", false, IgnoreMatch::Ignore},
+    {"a/**/b", "a/b", true, IgnoreMatch::Ignore},
+    {"**/cache", "x/y/cache", true, IgnoreMatch::Ignore},
+    // A trailing / matches directories only, at any depth
+    {"dir/", "dir", true, IgnoreMatch::Ignore},
+    {"dir/", "dir", false, IgnoreMatch::None},
+    {"dir/", "a/dir", true, IgnoreMatch::Ignore},
+    {"/dir/", "a/dir", true, IgnoreMatch::None},
+    {"[a-c].txt", "b.txt", false, IgnoreMatch::Ignore},
+    {"[a-c].txt", "d.txt", false, IgnoreMatch::None},
+    // Comments, blank lines, escapes and trailing spaces
+    {"# comment\n\n   \n", "# comment", false, IgnoreMatch::None},
+    {"\\#hash", "#hash", false, IgnoreMatch::Ignore},
+    {"\\!bang", "!bang", false, IgnoreMatch::Ignore},
+    {"name   ", "name", false, IgnoreMatch::Ignore},
+    {"name\\ ", "name ", false, IgnoreMatch::Ignore},
+    {"crlf\r\n", "crlf", false, IgnoreMatch::Ignore},
+    {"*.o", "main.c", false, IgnoreMatch::None},
+};
+
+// A tree with nested ignore files, and the files a walk visits under various options
+struct WalkCase {
+    const char* name;
+    WalkOptions options;
+    std::vector<std::string> expected;
+};
+
+const char* const kTreeFiles[][2] = {
+    {".gitignore", "*.log\nbuild/\n/top.txt\n"},
+    {".ignore", "deep/**/*.c\n"},
+    {"a.txt", ""},
+    {"top.txt", ""},
+    {"x.log", ""},
+    {"build/out.txt", ""},
+    {".git/config", ""},
+    {"deep/keep.h", ""},
+    {"deep/a/x/b.c", ""},
+    {"sub/.gitignore", "!keep.log\n"},
+    {"sub/keep.log", ""},
+    {"sub/drop.log", ""},
+    {"sub/top.txt", ""},
+    {"sub/build/out.txt", ""},
+};
+
+std::vector<WalkCase> walk_cases() {
+    std::vector<WalkCase> cases;
+    cases.push_back({"ignore files", {}, {".gitignore", ".ignore", "a.txt", "deep/keep.h", "sub/.gitignore",
+                                          "sub/keep.log", "sub/top.txt"}});
+
+    WalkCase no_ignore{"--no-ignore", {}, {}};
+    no_ignore.options.use_ignore_files = false;
+    no_ignore.expected = {".gitignore", ".ignore", "a.txt", "build/out.txt", "deep/a/x/b.c", "deep/keep.h",
+                          "sub/.gitignore", "sub/build/out.txt", "sub/drop.log", "sub/keep.log", "sub/top.txt",
+                          "top.txt", "x.log"};
+    cases.push_back(no_ignore);
+
+    WalkCase include{"--include", {}, {"a.txt", "sub/top.txt"}};
+    include.options.include_globs = {"*.txt"};
+    cases.push_back(include);
+
+    WalkCase exclude{"--exclude", {}, {"a.txt", "deep/keep.h", "sub/keep.log"}};
+    exclude.options.exclude_globs = {".*", "top*"};
+    cases.push_back(exclude);
+
+    WalkCase exclude_dir{"--exclude-dir", {}, {".gitignore", ".ignore", "a.txt", "deep/keep.h"}};
+    exclude_dir.options.exclude_dir_globs = {"s?b"};
+    cases.push_back(exclude_dir);
+    return cases;
+}
+
+const char* match_name(IgnoreMatch match) {
+    switch (match) {
+        case IgnoreMatch::Ignore: return "Ignore";
+        case IgnoreMatch::Whitelist: return "Whitelist";
+        case IgnoreMatch::None: break;
+    }
+    return "None";
+}
+
+std::string join(const std::vector<std::string>& paths) {
+    std::string out;
+    for (const std::string& path : paths) out += (out.empty() ? "" : " ") + path;
+    return out;
+}
+
+int main() {
+    size_t checks = 0;
+    size_t failures = 0;
+
+    for (const GlobCase& test : kGlobCases) {
+        checks++;
+        if (glob_match(test.pattern, test.text) != test.matches) {
+            failures++;
+            std::fprintf(stderr, "FAIL glob_match(\"%s\", \"%s\") should be %s\n", test.pattern, test.text,
+                         test.matches ? "true" : "false");
+        }
+    }
+
+    for (const RuleCase& test : kRuleCases) {
+        IgnoreRules rules;
+        rules.add_rules(test.rules);
+        IgnoreMatch match = rules.match(test.path, test.is_directory);
+        checks++;
+        if (match != test.expected) {
+            failures++;
+            std::fprintf(stderr, "FAIL rules \"%s\" on %s%s: %s, expected %s\n", test.rules, test.path,
+                         test.is_directory ? "/" : "", match_name(match), match_name(test.expected));
+        }
+    }
+
+    std::filesystem::path root = std::filesystem::temp_directory_path() / ("ignore_tests-" + std::to_string(getpid()));
+    for (const auto& [name, contents] : kTreeFiles) {
+        std::filesystem::path path = root / name;
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream(path) << contents;
+    }
+    for (const WalkCase& test : walk_cases()) {
+        std::vector<std::string> visited;
+        std::string prefix = root.string() + "/";
+        DirectoryWalker walker(
+            test.options,
+            [&](const std::string& path) {
+                visited.push_back(path.substr(prefix.size()));
+                return true;
+            },
+            [&](const std::string& message) { std::fprintf(stderr, "%s\n", message.c_str()); });
+        walker.walk(root.string());
+        checks++;
+        if (visited != test.expected) {
+            failures++;
+            std::fprintf(stderr, "FAIL walk with %s visited [%s], expected [%s]\n", test.name, join(visited).c_str(),
+                         join(test.expected).c_str());
+        }
+    }
+    std::filesystem::remove_all(root);
+
+    std::printf("%zu ignore checks, %zu failures\n", checks, failures);
+    return failures == 0 ? 0 : 1;
+}
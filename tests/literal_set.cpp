@@ -0,0 +1,163 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aho_corasick.hpp"
+#include "matcher.hpp"
+#include "pattern.hpp"
+#include "prefilter.hpp"
+
+// Checks the plain-string paths of multi-pattern search. AhoCorasick is
+// compared with a naive search, and every way compile_patterns can split a
+// pattern list (all literals, more than kMaxFinderLiterals of them mixed with
+// regexes, or few enough to stay in the program) is compared with the same
+// alternatives compiled as one group, which always runs on the regex engines.
+
+// Overlapping needles, needles that are suffixes or infixes of others, and a
+// needle that is a prefix of another
+const std::vector<std::string> kLiterals = {
+    "ab",  "aba", "abab", "bab",  "ba",   "needle", "dle",  "le",   "an",  "nab", "lad",
+    "deal", "lean", "ell", "bell", "dab", "ned",    "bead", "bald", "land", "and",
+};
+
+const std::vector<std::string> kFewLiterals = {"abab", "bab", "needle", "dle", "e"};
+
+// Lines over the letters of the needles: every one up to kExhaustiveLength, then random longer ones
+constexpr std::string_view kAlphabet = "abdeln";
+constexpr size_t kExhaustiveLength = 6;
+constexpr size_t kRandomLines = 3000;
+constexpr size_t kRandomMaxLength = 30;
+
+std::vector<std::string> make_lines() {
+    std::vector<std::string> lines{""};
+    for (size_t begin = 0, length = 1; length <= kExhaustiveLength; length++) {
+        size_t end = lines.size();
+        for (size_t i = begin; i < end; i++) {
+            for (char c : kAlphabet) lines.push_back(lines[i] + c);
+        }
+        begin = end;
+    }
+    std::mt19937 random(16);
+    for (size_t i = 0; i < kRandomLines; i++) {
+        std::string line(random() % (kRandomMaxLength + 1), ' ');
+        for (char& c : line) c = kAlphabet[random() % kAlphabet.size()];
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+struct Totals {
+    size_t checks = 0;
+    size_t failures = 0;
+};
+
+void fail(Totals& totals, const char* what, std::string_view line, const char* detail) {
+    totals.failures++;
+    if (totals.failures <= 20) {
+        std::fprintf(stderr, "FAIL %s on \"%.*s\": %s\n", what, static_cast<int>(line.size()), line.data(), detail);
+    }
+}
+
+// AhoCorasick::find from every offset must return an occurrence ending no later than any other
+void check_aho_corasick(Totals& totals, const std::vector<std::string>& needles, const std::vector<std::string>& lines) {
+    AhoCorasick automaton(needles);
+    for (const std::string& line : lines) {
+        for (size_t from = 0; from <= line.size(); from++) {
+            size_t first_end = std::string::npos;
+            for (const std::string& needle : needles) {
+                size_t at = line.find(needle, from);
+                if (at != std::string::npos && at + needle.size() < first_end) first_end = at + needle.size();
+            }
+
+            totals.checks++;
+            size_t found = automaton.find(line, from);
+            if (found == std::string_view::npos) {
+                if (first_end != std::string::npos) fail(totals, "AhoCorasick", line, "missed an occurrence");
+                continue;
+            }
+            bool valid = false;
+            for (const std::string& needle : needles) {
+                if (found >= from && line.compare(found, needle.size(), needle) == 0 &&
+                    found + needle.size() == first_end) {
+                    valid = true;
+                }
+            }
+            if (!valid) fail(totals, "AhoCorasick", line, "did not return the occurrence that ends first");
+        }
+        if (automaton.contains(line) != (automaton.find(line) != std::string_view::npos)) {
+            fail(totals, "AhoCorasick", line, "contains() disagrees with find()");
+        }
+    }
+}
+
+// Compile patterns as a list and as one group of alternatives, and compare match_string on every line
+void check_split(Totals& totals, const char* name, const std::vector<std::string>& patterns,
+                 const std::string& grouped, bool expect_literal_set, const std::vector<std::string>& lines) {
+    CompiledPattern split = compile_patterns(patterns, PatternOptions{0});
+    CompiledPattern single = compile_pattern(grouped, PatternOptions{0});
+    totals.checks++;
+    if (split.literal_set.empty() == expect_literal_set) {
+        fail(totals, name, "", expect_literal_set ? "literals were not given their own automaton"
+                                                  : "literals left the program");
+    }
+    if (!single.literal_set.empty() || single.literal_only) {
+        fail(totals, name, "", "the grouped reference did not compile to a single program");
+    }
+
+    MatchScratch split_scratch;
+    MatchScratch single_scratch;
+    for (const std::string& line : lines) {
+        totals.checks++;
+        bool expected = match_string(line, single, single_scratch);
+        if (match_string(line, split, split_scratch) != expected) {
+            fail(totals, name, line, expected ? "split patterns missed a match" : "split patterns matched");
+        }
+    }
+}
+
+// "(a|b|...)" over the given alternatives
+std::string group_of(const std::vector<std::string>& alternatives) {
+    std::string grouped = "(";
+    for (size_t i = 0; i < alternatives.size(); i++) {
+        grouped += (i > 0 ? "|" : "") + alternatives[i];
+    }
+    return grouped + ")";
+}
+
+int main() {
+    std::vector<std::string> lines = make_lines();
+    Totals totals;
+
+    if (kLiterals.size() <= kMaxFinderLiterals) {
+        std::fprintf(stderr, "FAIL kLiterals must hold more than kMaxFinderLiterals needles\n");
+        return 1;
+    }
+    check_aho_corasick(totals, kLiterals, lines);
+    check_aho_corasick(totals, kFewLiterals, lines);
+
+    // Every alternative plain: decided by the prefilter alone
+    check_split(totals, "literals only", kLiterals, group_of(kLiterals), false, lines);
+
+    // Many literals and regexes: the literals get an automaton, the rest a program
+    std::vector<std::string> mixed = kLiterals;
+    mixed.push_back("e[a-d]+n");
+    mixed.push_back("^l");
+    check_split(totals, "literals and regexes", mixed, group_of(mixed), true, lines);
+
+    // A backreference in the regex part, numbered one higher inside the reference group
+    std::vector<std::string> with_backref = kLiterals;
+    with_backref.push_back("(l)\\1e");
+    std::vector<std::string> renumbered = kLiterals;
+    renumbered.push_back("(l)\\2e");
+    check_split(totals, "literals and a backreference", with_backref, group_of(renumbered), true, lines);
+
+    // Few literals stay in the program with the regex
+    std::vector<std::string> few = kFewLiterals;
+    few.push_back("e[a-d]+n");
+    check_split(totals, "few literals and a regex", few, group_of(few), false, lines);
+
+    std::printf("%zu literal-set checks on %zu lines, %zu failures\n", totals.checks, lines.size(), totals.failures);
+    return totals.failures == 0 ? 0 : 1;
+}
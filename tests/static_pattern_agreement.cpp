@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "corpus.hpp"
+#include "matcher.hpp"
+#include "pattern.hpp"
+#include "static_pattern.hpp"
+
+// Checks that StaticPattern, which parses and determinizes at compile time,
+// gives the same answer as match_string on the runtime engines: for dialect
+// corners on short lines over a small alphabet, and for the benchmark's
+// static patterns on lines of the benchmark corpora.
+
+template <PatternString... Patterns>
+struct StaticCases {};
+
+// Dialect corners, including the parser's treatment of malformed input
+using kDialectCases =
+    StaticCases<"", "a", "ab|b", "a?b+", "(a|b)*1", "^a", "b$", "^$", "$^", "^(ab)+$", "[a-c]+1", "[^a]b", "\\d+",
+                "\\w+ x", "a.b", "(a*)*b$", "()", "a|", "x)y", "(^a|b$)", "[\\d_-]+", "a**", "\\.", "[a-]",
+                "a$|^b", "(a(b|)?)+$", "[]a]", "\\", "a\\", "(|a)+b", "^*a", "(a+|b+)*x$">;
+
+// Patterns grep_bench times through StaticPattern
+using kBenchCases = StaticCases<"timeout", "segfault", "[0-9]+ms", "GET|PUT|DELETE",
+                                "(host-(\\d+) )+(GET|POST) /api/v1/(items|users)", "^2024-0[1-6].*ERROR.*ms$",
+                                "(a*)*c$">;
+
+static_assert(StaticPattern<"user_id=\\d+">::matches("GET /?user_id=42"));
+static_assert(!StaticPattern<"user_id=\\d+">::matches("user_id=x"));
+static_assert(StaticPattern<"^(GET|PUT) /$">::matches("PUT /"));
+
+// Every line up to kShortLineLength bytes over kAlphabet, plus random longer ones
+constexpr std::string_view kAlphabet = "ab1 x_.-";
+constexpr size_t kShortLineLength = 5;
+constexpr int kRandomLines = 20000;
+constexpr size_t kRandomMaxLength = 40;
+
+std::vector<std::string> make_short_lines() {
+    std::vector<std::string> lines{""};
+    for (size_t begin = 0, length = 1; length <= kShortLineLength; length++) {
+        size_t end = lines.size();
+        for (size_t i = begin; i < end; i++) {
+            for (char c : kAlphabet) lines.push_back(lines[i] + c);
+        }
+        begin = end;
+    }
+    std::mt19937 rng(7);
+    for (int i = 0; i < kRandomLines; i++) {
+        std::string line(rng() % kRandomMaxLength, ' ');
+        for (char& c : line) c = kAlphabet[rng() % kAlphabet.size()];
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+// Lines of small versions of the benchmark corpora
+std::vector<std::string> make_corpus_lines() {
+    std::string text = generate_log(256 << 10, 1) + generate_dense(64 << 10, 3) + generate_pathological(16 << 10);
+    std::vector<std::string> lines;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        lines.push_back(text.substr(start, end - start));
+        start = end + 1;
+    }
+    return lines;
+}
+
+// Compare every pattern with match_string on every line; returns the number of disagreements
+template <PatternString... Patterns>
+size_t check_cases(StaticCases<Patterns...>, const std::vector<std::string>& lines, const char* label) {
+    size_t failures = 0;
+    auto check = [&]<PatternString Pattern>() {
+        CompiledPattern compiled = compile_pattern(StaticPattern<Pattern>::source());
+        for (const std::string& line : lines) {
+            bool expected = match_string(line, compiled);
+            if (StaticPattern<Pattern>::matches(line) != expected) {
+                if (++failures <= 20) {
+                    std::fprintf(stderr, "FAIL %.*s on \"%s\" (%s lines): StaticPattern says %s\n",
+                                 static_cast<int>(StaticPattern<Pattern>::source().size()),
+                                 StaticPattern<Pattern>::source().data(), line.c_str(), label,
+                                 expected ? "no match" : "match");
+                }
+            }
+        }
+    };
+    (check.template operator()<Patterns>(), ...);
+    take_skipped_lines();
+    return failures;
+}
+
+int main() {
+    std::vector<std::string> short_lines = make_short_lines();
+    std::vector<std::string> corpus_lines = make_corpus_lines();
+
+    size_t failures = check_cases(kDialectCases{}, short_lines, "short") +
+                      check_cases(kBenchCases{}, short_lines, "short") +
+                      check_cases(kBenchCases{}, corpus_lines, "corpus");
+
+    std::printf("StaticPattern checked on %zu short and %zu corpus lines, %zu failures\n", short_lines.size(),
+                corpus_lines.size(), failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "pattern.hpp"
+#include "trigram_index.hpp"
+
+// Checks that an index built from one spelling of a tree rules files in and
+// out the same way for every other spelling of their paths and from another
+// working directory, and that new and changed files are never ruled out.
+
+const char* const kTreeFiles[][2] = {
+    {"a.txt", "say hello world\n"},
+    {"b.txt", "goodbye\n"},
+    {"dir/c.txt", "hello there\n"},
+    {"dir/d.txt", "nothing here\n"},
+};
+
+struct Totals {
+    size_t checks = 0;
+    size_t failures = 0;
+};
+
+void expect(Totals& totals, bool actual, bool expected, const std::string& what) {
+    totals.checks++;
+    if (actual != expected) {
+        totals.failures++;
+        std::fprintf(stderr, "FAIL %s: %s, expected %s\n", what.c_str(), actual ? "true" : "false",
+                     expected ? "true" : "false");
+    }
+}
+
+// may_match for each path, with the label naming the pattern and working directory
+void expect_matches(Totals& totals, const TrigramIndex& index, const char* pattern, const std::string& label,
+                    const std::vector<std::pair<std::string, bool>>& paths) {
+    IndexCandidates candidates = index.candidates(trigram_query(compile_pattern(pattern)));
+    for (const auto& [path, expected] : paths) {
+        expect(totals, index.may_match(path, candidates), expected,
+               std::string("may_match(") + path + ") for " + pattern + " from " + label);
+    }
+}
+
+void write_file(const std::filesystem::path& path, const char* contents) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << contents;
+}
+
+int main() {
+    Totals totals;
+    std::filesystem::path start = std::filesystem::current_path();
+    std::filesystem::path root = std::filesystem::temp_directory_path() / ("index_tests-" + std::to_string(getpid()));
+    for (const auto& [name, contents] : kTreeFiles) write_file(root / name, contents);
+    std::filesystem::current_path(root);
+
+    std::string error;
+    if (!build_index({"."}, WalkOptions{}, "idx", 1, nullptr, error)) {
+        std::fprintf(stderr, "FAIL build_index: %s\n", error.c_str());
+        return 1;
+    }
+
+    TrigramIndex index;
+    expect(totals, index.load("idx"), true, "load");
+    expect(totals, index.size() == 4, true, "four files indexed");
+    expect(totals, index.is_index_file("./idx"), true, "is_index_file(./idx)");
+    expect_matches(totals, index, "hello", "the root",
+                   {{"a.txt", true}, {"./a.txt", true}, {"dir/c.txt", true}, {"./dir/../dir/c.txt", true},
+                    {"b.txt", false}, {"./b.txt", false}, {"dir/d.txt", false}, {"./dir/./d.txt", false}});
+    expect_matches(totals, index, "hel+o|good", "the root", {{"a.txt", true}, {"b.txt", true}, {"dir/d.txt", false}});
+    expect_matches(totals, index, "x", "the root", {{"b.txt", true}, {"dir/d.txt", true}});
+
+    // The same index loaded from inside the tree, with paths relative to there
+    std::filesystem::current_path(root / "dir");
+    TrigramIndex nested;
+    expect(totals, nested.load("../idx"), true, "load from dir");
+    expect_matches(totals, nested, "hello", "dir", {{"c.txt", true}, {"./c.txt", true}, {"d.txt", false},
+                                                    {"../b.txt", false}, {(root / "b.txt").string(), false}});
+
+    // New and changed files are read until the index is updated
+    std::filesystem::current_path(root);
+    write_file(root / "b.txt", "hello again, now longer\n");
+    write_file(root / "dir/e.txt", "nothing\n");
+    expect_matches(totals, index, "hello", "the root after edits", {{"b.txt", true}, {"dir/e.txt", true}});
+
+    TrigramIndex updated;
+    if (!build_index({"./", "dir"}, WalkOptions{}, "idx", 2, &index, error)) {
+        std::fprintf(stderr, "FAIL update: %s\n", error.c_str());
+        return 1;
+    }
+    expect(totals, updated.load("idx"), true, "load after update");
+    expect(totals, updated.size() == 5, true, "overlapping roots indexed once");
+    expect_matches(totals, updated, "hello", "the root after update",
+                   {{"a.txt", true}, {"b.txt", true}, {"dir/c.txt", true}, {"dir/d.txt", false}, {"dir/e.txt", false}});
+
+    std::filesystem::current_path(start);
+    std::filesystem::remove_all(root);
+
+    std::printf("%zu index checks, %zu failures\n", totals.checks, totals.failures);
+    return totals.failures == 0 ? 0 : 1;
+}